@@ -19,9 +19,14 @@
  */
 
 #include <cstdio>
+#include <cstdlib>
 #include <string>
 #include <stdexcept>
 #include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <unistd.h>
 #include "BShapr.hpp"
 #include "BUtilities/stof.hpp"
 
@@ -124,32 +129,57 @@ Fader::Fader () : Fader (0, 1) {}
 
 Fader::Fader (const float value, const float speed) :
 	value (value),
-	target (value),
 	speed (speed)
 {}
-	
-inline void Fader::setTarget (const float target) {this->target = target;}
 
 inline void Fader::setSpeed (const float speed) {this->speed = speed;}
 
-inline float Fader::proceed ()
+inline void Fader::proceed (const float* targets, float* values, const uint32_t n)
 {
-	if (fabsf (target - value) < speed) value = target;
-	else value += SGN (target - value) * speed;
-	return value;
+	// Keep the loops free of function calls and data dependent branches
+	float v = value;
+	const float s = speed;
+
+	for (uint32_t i = 0; i < n; ++i)
+	{
+		const float d = targets[i] - v;
+		v = ((d < s) && (d > -s) ? targets[i] : (d > 0 ? v + s : (d < 0 ? v - s : v)));
+		values[i] = v;
+	}
+
+	value = v;
 }
 
+inline void Fader::hold (float* values, const uint32_t n) const {std::fill (values, values + n, value);}
+
 inline float Fader::getValue () const {return value;}
 
+ShaperState::ShaperState () :
+	factor (),
+	decimateBuffer1 (0), decimateBuffer2 (0), decimateCounter (0),
+	audioBuffer1 (), audioBuffer2 (),
+	sendValue (0xFF), cpuCycles (0)
+{
+	resetFilters (0);
+}
+
+void ShaperState::resetFilters (const float value)
+{
+	std::fill (filter1Buffer1, filter1Buffer1 + MAX_F_ORDER / 2, value);
+	std::fill (filter1Buffer2, filter1Buffer2 + MAX_F_ORDER / 2, value);
+	std::fill (filter2Buffer1, filter2Buffer1 + MAX_F_ORDER / 2, value);
+	std::fill (filter2Buffer2, filter2Buffer2 + MAX_F_ORDER / 2, value);
+}
+
 
 BShapr::BShapr (double samplerate, const LV2_Feature* const* features) :
 	map(NULL),
 	rate(samplerate), bpm(120.0f), speed(1), bar (0), barBeat (0), beatsPerBar (4), beatUnit (4),
-	position(0), offset(0), refFrame(0),
+	phase(0), offset(0), increment(0), phaseCorrection(0),
 	audioInput1(NULL), audioInput2(NULL), audioOutput1(NULL), audioOutput2(NULL),
-	new_controllers {NULL}, controllers {0},
-	reverbs {AceReverb (rate, 0.75, powf (10.0f, .05f * -20.0f), -0.015f, 1.0f)},
+	new_controllers {NULL}, controllers {0}, portValues {0}, parameterUrids {0}, parameterRestored {false},
 	shapes {Shape<MAXNODES> ()}, tempNodes {StaticArrayList<Node, MAXNODES> ()},
+	reverbs {AceReverb (rate, 0.75, powf (10.0f, .05f * -20.0f), -0.015f, 1.0f)},
 	urids (), controlPort(NULL), notifyPort(NULL),
 
 #ifdef SUPPORTS_CV
@@ -159,28 +189,25 @@ BShapr::BShapr (double samplerate, const LV2_Feature* const* features) :
 	forge (), notify_frame (),
 	key (0xFF),
 	ui_on(false), message (), monitorPos(-1), notificationsCount(0), stepCount (0),
-	scheduleNotifyStatus (true)
+	scheduleNotifyStatus (true), scheduleNotifyControllers {false},
+	cycleCounter (), cpuLoadCountdown (0), cpuLoadFrames (0), cpuLoad {0.0f},
+	runtimeEvents (0), runtimeThreshold (RUNTIMETHRESHOLD), runtimeHistogram {0}, runtimeOverloads {0},
+	capture (nullptr)
 
 {
-	std::fill (sendValue, sendValue + MAXSHAPES, 0xFF);
-	std::fill (factors, factors + MAXSHAPES, Fader (0, 1.0f / (0.02f * rate)));
-
 	for (int i = 0; i < MAXSHAPES; ++i)
 	{
+		shapers[i].factor = Fader (0, 1.0f / (0.02f * rate));
 		shapes[i].setDefaultShape ();
 		shapes[i].setTransformation (methods[0].transformFactor, methods[0].transformOffset);
 
-		try {audioBuffer1[i].resize (samplerate);}
+		try {shapers[i].audioBuffer1.resize (samplerate);}
 		catch (std::bad_alloc& ba) {throw ba;}
 
-		try {audioBuffer2[i].resize (samplerate);}
+		try {shapers[i].audioBuffer2.resize (samplerate);}
 		catch (std::bad_alloc& ba) {throw ba;}
 	}
 	notifications.fill ({0.0f, {0.0f, 0.0f}, {0.0f, 0.0f}, {0.0f, 0.0f}, {0.0f, 0.0f}});
-	fillFilterBuffer (filter1Buffer1, 0);
-	fillFilterBuffer (filter1Buffer2, 0);
-	fillFilterBuffer (filter2Buffer1, 0);
-	fillFilterBuffer (filter2Buffer2, 0);
 
 	//Scan host features for URID map
 	LV2_URID_Map* m = NULL;
@@ -196,14 +223,48 @@ BShapr::BShapr (double samplerate, const LV2_Feature* const* features) :
 	//Map URIS
 	map = m;
 	mapURIDs (m, &urids);
+	for (int i = 0; i < NR_CONTROLLERS; ++i) parameterUrids[i] = m->map (m->handle, getControllerUri (i).c_str ());
 
 	// Initialize forge
 	lv2_atom_forge_init (&forge, map);
 
 	for (int i = 0; i < MAXSHAPES; ++i) scheduleNotifyShapes[i] = true;
+
+	// Capture the control input of this instance for offline replay if the
+	// environment variable BSHAPR_CAPTURE is set to a directory
+	const char* captureDir = getenv ("BSHAPR_CAPTURE");
+	if (captureDir && captureDir[0])
+	{
+		static std::atomic<int> instanceCount (0);
+		const std::string filename =
+		(
+			std::string (captureDir) + "/bshapr-" + std::to_string (getpid ()) + "-" +
+			std::to_string (++instanceCount) + ".bscap"
+		);
+
+		try
+		{
+			capture = new Capture (filename, rate, map);
+			fprintf (stderr, "BShapr.lv2: Capture control input to %s\n", filename.c_str ());
+		}
+		catch (std::exception& exc) {fprintf (stderr, "BShapr.lv2: Capture disabled. %s\n", exc.what ());}
+	}
+}
+
+BShapr::~BShapr ()
+{
+	if (capture) delete capture;
 }
 
-BShapr::~BShapr () {}
+void* BShapr::operator new (size_t size)
+{
+	// Plain new doesn't respect the ShaperState alignment before C++17
+	void* ptr = nullptr;
+	if (posix_memalign (&ptr, CACHELINESIZE, size) != 0) throw std::bad_alloc ();
+	return ptr;
+}
+
+void BShapr::operator delete (void* ptr) {free (ptr);}
 
 void BShapr::connect_port(uint32_t port, void *data)
 {
@@ -237,15 +298,9 @@ void BShapr::connect_port(uint32_t port, void *data)
 	}
 }
 
-void BShapr::fillFilterBuffer (float filterBuffer[MAXSHAPES] [MAX_F_ORDER / 2], const float value)
+void BShapr::resetFilters (const float value)
 {
-	for (int i = 0; i < MAXSHAPES; ++ i)
-	{
-		for (int j = 0; j < MAX_F_ORDER / 2; ++ j)
-		{
-			filterBuffer[i][j] = value;
-		}
-	}
+	for (int i = 0; i < MAXSHAPES; ++ i) shapers[i].resetFilters (value);
 }
 
 bool BShapr::isAudioOutputConnected (int shapeNr)
@@ -274,16 +329,42 @@ double BShapr::getPositionFromBeats (double beats)
 	}
 }
 
-double BShapr::getPositionFromFrames (uint64_t frames)
+void BShapr::updateIncrement ()
 {
-	if ((controllers[BASE_VALUE] == 0.0) || (rate == 0)) return 0.0;
+	// Position change per frame, update on any change of rate, BASE,
+	// BASE_VALUE, bpm, speed or beatsPerBar
+	if ((controllers[BASE_VALUE] == 0.0) || (rate == 0))
+	{
+		increment = 0.0;
+		return;
+	}
 
 	switch (int (controllers[BASE]))
 	{
-		case SECONDS: 	return frames * (1.0 / rate) / controllers[BASE_VALUE] ;
-		case BEATS:	return (bpm ? frames * (speed / (rate / (bpm / 60))) / controllers[BASE_VALUE] : 0.0);
-		case BARS:	return (bpm && beatsPerBar ? frames * (speed / (rate / (bpm / 60))) / (controllers[BASE_VALUE] * beatsPerBar) : 0.0);
-		default:	return 0.0;
+		case SECONDS: 	increment = (1.0 / rate) / controllers[BASE_VALUE];
+				break;
+		case BEATS:	increment = (bpm ? (speed / (rate / (bpm / 60))) / controllers[BASE_VALUE] : 0.0);
+				break;
+		case BARS:	increment = (bpm && beatsPerBar ? (speed / (rate / (bpm / 60))) / (controllers[BASE_VALUE] * beatsPerBar) : 0.0);
+				break;
+		default:	increment = 0.0;
+	}
+}
+
+void BShapr::syncPhase (const double pos)
+{
+	// Deviation from the host position, shortest way around the loop
+	double diff = pos - phase;
+	diff -= round (diff);
+
+	// Small deviation (drift, jitter): Correct smoothly within the next frames
+	if ((increment != 0.0) && (fabs (diff) <= PHASESYNCFRAMES * fabs (increment))) phaseCorrection = diff;
+
+	// Otherwise (relocation, start): Hard set
+	else
+	{
+		phase = floorfrac (pos);
+		phaseCorrection = 0.0;
 	}
 }
 
@@ -300,115 +381,162 @@ double BShapr::getPositionFromSeconds (double seconds)
 	}
 }
 
-void BShapr::run (uint32_t n_samples)
+void BShapr::setController (const int i, const float value)
 {
-	// Check ports
-	if ((!controlPort) || (!notifyPort) || (!audioInput1) || (!audioInput2) || (!audioOutput1) || (!audioOutput2)) return;
+	float newValue = value;
+	int shapeNr = ((i >= SHAPERS) ? ((i - SHAPERS) / SH_SIZE) : -1);
+	int shapeControllerNr = ((i >= SHAPERS) ? ((i - SHAPERS) % SH_SIZE) : -1);
 
-	for (int i = 0; i < NR_CONTROLLERS; ++i) if (!new_controllers[i]) return;
-
-	// Prepare forge buffer and initialize atom sequence
-	const uint32_t space = notifyPort->atom.size;
-	lv2_atom_forge_set_buffer(&forge, (uint8_t*) notifyPort, space);
-	lv2_atom_forge_sequence_head(&forge, &notify_frame, 0);
-
-	// Update controller values
-	for (int i = 0; i < NR_CONTROLLERS; ++i)
+	// Global controllers
+	if (i < SHAPERS)
 	{
-		if (controllers[i] != *new_controllers[i])
-		{
-			float newValue = *new_controllers[i];
-			int shapeNr = ((i >= SHAPERS) ? ((i - SHAPERS) / SH_SIZE) : -1);
-			int shapeControllerNr = ((i >= SHAPERS) ? ((i - SHAPERS) % SH_SIZE) : -1);
+		newValue = globalControllerLimits[i].validate (newValue);
 
-			// Global controllers
-			if (i < SHAPERS)
+		if (i == MIDI_CONTROL)
+		{
+			if (newValue == 0.0f)
 			{
-				newValue = globalControllerLimits[i].validate (newValue);
-
-				if (i == MIDI_CONTROL)
-				{
-					if (newValue == 0.0f)
-					{
-						// Hard set position back to offset-independent position
-						position = floorfrac (position + offset);
-						offset = 0;
-					}
+				// Hard set position back to offset-independent position
+				phase = floorfrac (phase + offset);
+				offset = 0;
+			}
 
-					else key = 0xFF;
-				}
+			else key = 0xFF;
+		}
 
-				else if (i == BASE)
-				{
-					if (newValue == SECONDS)
-					{
-						if (bpm < 1.0) message.setMessage (JACK_STOP_MSG);
-						else message.deleteMessage (JACK_STOP_MSG);
-					}
-					else
-					{
-						if ((speed == 0) || (bpm < 1.0)) message.setMessage (JACK_STOP_MSG);
-						else message.deleteMessage (JACK_STOP_MSG);
-					}
-				}
+		if (i == BASE)
+		{
+			if (newValue == SECONDS)
+			{
+				if (bpm < 1.0) message.setMessage (JACK_STOP_MSG);
+				else message.deleteMessage (JACK_STOP_MSG);
 			}
-
-			// Shape controllers
 			else
 			{
-				newValue = shapeControllerLimits[shapeControllerNr].validate (newValue);
+				if ((speed == 0) || (bpm < 1.0)) message.setMessage (JACK_STOP_MSG);
+				else message.deleteMessage (JACK_STOP_MSG);
+			}
+		}
+	}
 
-				// Target
-				if (shapeControllerNr == SH_TARGET)
-				{
-					// Change transformation
-					shapes[shapeNr].setTransformation (methods[int(newValue)].transformFactor, methods[int(newValue)].transformOffset);
-					const float sm = controllers[SHAPERS + shapeNr * SH_SIZE + SH_SMOOTHING];
-					factors[shapeNr] = Fader
-					(
-						methods[int(newValue)].transformOffset, 
-						methods[int(newValue)].step / (0.001f * sm * rate)
-					);
-
-					// Clear audiobuffers, if needed
-					if
-					(
-						(newValue == BShaprTargetIndex::PITCH) ||
-						(newValue == BShaprTargetIndex::DELAY) ||
-						(newValue == BShaprTargetIndex::DOPPLER)
-					)
-					{
-						audioBuffer1[shapeNr].reset ();
-						audioBuffer2[shapeNr].reset ();
-					}
+	// Shape controllers
+	else
+	{
+		newValue = shapeControllerLimits[shapeControllerNr].validate (newValue);
+
+		// Target
+		if (shapeControllerNr == SH_TARGET)
+		{
+			// Change transformation
+			shapes[shapeNr].setTransformation (methods[int(newValue)].transformFactor, methods[int(newValue)].transformOffset);
+			const float sm = controllers[SHAPERS + shapeNr * SH_SIZE + SH_SMOOTHING];
+			shapers[shapeNr].factor = Fader
+			(
+				methods[int(newValue)].transformOffset, 
+				methods[int(newValue)].step / (0.001f * sm * rate)
+			);
+
+			// Clear audiobuffers, if needed
+			if
+			(
+				(newValue == BShaprTargetIndex::PITCH) ||
+				(newValue == BShaprTargetIndex::DELAY) ||
+				(newValue == BShaprTargetIndex::DOPPLER)
+			)
+			{
+				shapers[shapeNr].audioBuffer1.reset ();
+				shapers[shapeNr].audioBuffer2.reset ();
+			}
 
 #ifndef SUPPORTS_CV
-					// Force update & send MIDI if switched to MIDI
-					else if (newValue == BShaprTargetIndex::SEND_MIDI) sendValue[shapeNr] = 0xff;
+			// Force update & send MIDI if switched to MIDI
+			else if (newValue == BShaprTargetIndex::SEND_MIDI) shapers[shapeNr].sendValue = 0xff;
 #endif
-				}
+		}
 
-				else if (shapeControllerNr == SH_SMOOTHING)
-				{
-					const int me = controllers[SHAPERS + shapeNr * SH_SIZE + SH_TARGET];
-					factors[shapeNr].setSpeed (methods[me].step/ (0.001f * newValue * rate));
-				}
+		else if (shapeControllerNr == SH_SMOOTHING)
+		{
+			const int me = controllers[SHAPERS + shapeNr * SH_SIZE + SH_TARGET];
+			shapers[shapeNr].factor.setSpeed (methods[me].step/ (0.001f * newValue * rate));
+		}
 
-				// Options
-				else if ((shapeControllerNr >= SH_OPTION) && (shapeControllerNr < SH_OPTION + MAXOPTIONS))
-				{
-					int optionNr = shapeControllerNr - SH_OPTION;
-					newValue = options[optionNr].limit.validate (newValue);
+		// Options
+		else if ((shapeControllerNr >= SH_OPTION) && (shapeControllerNr < SH_OPTION + MAXOPTIONS))
+		{
+			int optionNr = shapeControllerNr - SH_OPTION;
+			newValue = options[optionNr].limit.validate (newValue);
 
-					// Force update & send MIDI if parameter changed
-					if ((optionNr == SEND_MIDI_CH) || (optionNr == SEND_MIDI_CC)) sendValue[shapeNr] = 0xff;
-				}
-			}
+			// Force update & send MIDI if parameter changed
+			if ((optionNr == SEND_MIDI_CH) || (optionNr == SEND_MIDI_CC)) shapers[shapeNr].sendValue = 0xff;
+		}
+	}
+
+	controllers[i] = newValue;
+	if ((i == BASE) || (i == BASE_VALUE)) updateIncrement ();
+}
+
+bool BShapr::isTimedEvent (const LV2_Atom_Event* ev) const
+{
+	// Transport and parameter changes
+	if ((ev->body.type == urids.atom_Object) || (ev->body.type == urids.atom_Blank))
+	{
+		const LV2_Atom_Object* obj = (const LV2_Atom_Object*)&ev->body;
+		return ((obj->body.otype == urids.time_Position) || (obj->body.otype == urids.patch_Set));
+	}
 
-			controllers[i] = newValue;
+	// MIDI
+	if (ev->body.type == urids.midi_Event)
+	{
+		// MIDI thru: Forwarded MIDI events must not precede the MIDI CCs
+		// sent by play () for the frames before
+		if (controllers[MIDI_THRU] != 0.0f) return true;
+
+		// MIDI control: Note on, note off and controllers
+		if (controllers[MIDI_CONTROL] == 1.0f)
+		{
+			const uint8_t typ = lv2_midi_message_type ((const uint8_t*)(ev + 1));
+			return ((typ == LV2_MIDI_MSG_NOTE_ON) || (typ == LV2_MIDI_MSG_NOTE_OFF) || (typ == LV2_MIDI_MSG_CONTROLLER));
 		}
 	}
 
+	// GUI and other messages
+	return false;
+}
+
+void BShapr::run (uint32_t n_samples)
+{
+	// Check ports
+	if ((!controlPort) || (!notifyPort) || (!audioInput1) || (!audioInput2) || (!audioOutput1) || (!audioOutput2)) return;
+
+	for (int i = 0; i < NR_CONTROLLERS; ++i) if (!new_controllers[i]) return;
+
+	if (capture) capture->captureBlock (n_samples, new_controllers, controlPort);
+
+	cycleCounter.update ();
+
+	// run () time by the steady clock as the cycle counter is only
+	// calibrated after CYCLECALIBRATIONTIME
+	const std::chrono::steady_clock::time_point runStart = std::chrono::steady_clock::now ();
+	runtimeEvents = 0;
+
+	// Prepare forge buffer and initialize atom sequence
+	const uint32_t space = notifyPort->atom.size;
+	lv2_atom_forge_set_buffer(&forge, (uint8_t*) notifyPort, space);
+	lv2_atom_forge_sequence_head(&forge, &notify_frame, 0);
+
+	// Update controller values if changed at the ports. Compared with the
+	// last port values as the controllers may also be set by patch:Set.
+	// Parameter values restored from the state survive the first port read.
+	for (int i = 0; i < NR_CONTROLLERS; ++i)
+	{
+		if (portValues[i] != *new_controllers[i])
+		{
+			portValues[i] = *new_controllers[i];
+			if ((!parameterRestored[i]) && (portValues[i] != controllers[i])) setController (i, portValues[i]);
+		}
+		parameterRestored[i] = false;
+	}
+
 	// Check for waiting tempNodes
 	for (int i = 0; i < MAXSHAPES; ++i)
 	{
@@ -433,6 +561,16 @@ void BShapr::run (uint32_t n_samples)
 	uint32_t last_t = 0;
 	LV2_ATOM_SEQUENCE_FOREACH(controlPort, ev)
 	{
+		// Play frames until the event. Only events changing the audio or the
+		// output at their frame split the block, GUI and state messages are
+		// applied right away.
+		if (isTimedEvent (ev))
+		{
+			uint32_t next_t = (ev->time.frames < n_samples ? ev->time.frames : n_samples);
+			play (last_t, next_t);
+			last_t = next_t;
+		}
+
 		// Read host & GUI events
 		if ((ev->body.type == urids.atom_Object) || (ev->body.type == urids.atom_Blank))
 		{
@@ -443,6 +581,12 @@ void BShapr::run (uint32_t n_samples)
 			{
 				ui_on = true;
 				for (int i = 0; i < MAXSHAPES; ++i) scheduleNotifyShapes[i] = true;
+
+				// The GUI only knows the port values
+				for (int i = 0; i < NR_CONTROLLERS; ++i)
+				{
+					if (controllers[i] != portValues[i]) scheduleNotifyControllers[i] = true;
+				}
 			}
 
 			// Process GUI off status data
@@ -479,6 +623,47 @@ void BShapr::run (uint32_t n_samples)
 								shapes[shapeNr].appendRawNode (node);
 							}
 							shapes[shapeNr].validateShape();
+							runtimeEvents |= (1 << SHAPE_RENDER_EVENT);
+						}
+					}
+				}
+			}
+
+			// Process runtime telemetry threshold
+			else if (obj->body.otype == urids.notify_runtimeEvent)
+			{
+				LV2_Atom *oThreshold = NULL;
+				lv2_atom_object_get (obj, urids.notify_runtimeThreshold, &oThreshold, NULL);
+				if (oThreshold && (oThreshold->type == urids.atom_Float) && (((LV2_Atom_Float*)oThreshold)->body > 0.0f))
+				{
+					runtimeThreshold = ((LV2_Atom_Float*)oThreshold)->body;
+				}
+			}
+
+			// Process sample accurate parameter changes
+			else if (obj->body.otype == urids.patch_Set)
+			{
+				LV2_Atom *oProperty = NULL, *oValue = NULL;
+				lv2_atom_object_get (obj, urids.patch_property, &oProperty, urids.patch_value, &oValue, NULL);
+
+				if (oProperty && (oProperty->type == urids.atom_URID) && oValue)
+				{
+					const LV2_URID property = ((LV2_Atom_URID*)oProperty)->body;
+					int nr = 0;
+					while ((nr < NR_CONTROLLERS) && (parameterUrids[nr] != property)) ++nr;
+
+					if ((nr < NR_CONTROLLERS) && isParameterController (nr))
+					{
+						float value = controllers[nr];
+						if (oValue->type == urids.atom_Float) value = ((LV2_Atom_Float*)oValue)->body;
+						else if (oValue->type == urids.atom_Double) value = ((LV2_Atom_Double*)oValue)->body;
+						else if (oValue->type == urids.atom_Int) value = ((LV2_Atom_Int*)oValue)->body;
+						else if (oValue->type == urids.atom_Long) value = ((LV2_Atom_Long*)oValue)->body;
+
+						if (value != controllers[nr])
+						{
+							setController (nr, value);
+							scheduleNotifyControllers[nr] = true;
 						}
 					}
 				}
@@ -515,10 +700,7 @@ void BShapr::run (uint32_t n_samples)
 						if (nbpm < 1.0)
 						{
 							message.setMessage (JACK_STOP_MSG);
-							fillFilterBuffer (filter1Buffer1, 0);
-							fillFilterBuffer (filter1Buffer2, 0);
-							fillFilterBuffer (filter2Buffer1, 0);
-							fillFilterBuffer (filter2Buffer2, 0);
+							resetFilters (0);
 						}
 
 						else message.deleteMessage (JACK_STOP_MSG);
@@ -555,8 +737,8 @@ void BShapr::run (uint32_t n_samples)
 							{
 								for (int i = 0; i < MAXSHAPES; ++i)
 								{
-									audioBuffer1[i].reset ();
-									audioBuffer2[i].reset ();
+									shapers[i].audioBuffer1.reset ();
+									shapers[i].audioBuffer2.reset ();
 								}
 							}
 
@@ -564,10 +746,7 @@ void BShapr::run (uint32_t n_samples)
 							if (nspeed == 0)
 							{
 								message.setMessage (JACK_STOP_MSG);
-								fillFilterBuffer (filter1Buffer1, 0);
-								fillFilterBuffer (filter1Buffer2, 0);
-								fillFilterBuffer (filter2Buffer1, 0);
-								fillFilterBuffer (filter2Buffer2, 0);
+								resetFilters (0);
 							}
 
 							// Not stopped ?
@@ -592,12 +771,13 @@ void BShapr::run (uint32_t n_samples)
 					scheduleUpdatePosition = true;
 				}
 
+				updateIncrement ();
+
+				// Sync to the new position if new data received
 				if (scheduleUpdatePosition)
 				{
-					// Hard set new position if new data received
 					double pos = getPositionFromBeats (barBeat + beatsPerBar * bar);
-					position = floorfrac (pos - offset);
-					refFrame = ev->time.frames;
+					syncPhase (pos - offset);
 				}
 			}
 		}
@@ -635,9 +815,9 @@ void BShapr::run (uint32_t n_samples)
 						if (filter & (1 << (note % 12)))
 						{
 							key = note;
-							offset = floorfrac (position + offset);
-							position = 0;
-							refFrame = ev->time.frames;
+							offset = floorfrac (phase + offset);
+							phase = 0;
+							phaseCorrection = 0;
 						}
 					}
 					break;
@@ -665,19 +845,12 @@ void BShapr::run (uint32_t n_samples)
 				}
 			}
 		}
-
-		uint32_t next_t = (ev->time.frames < n_samples ? ev->time.frames : n_samples);
-		play (last_t, next_t);
-		last_t = next_t;
 	}
 
 	// Play remaining samples
 	if (last_t < n_samples) play (last_t, n_samples);
-
-	// Update position in case of no new barBeat submitted on next call
-	double relpos = getPositionFromFrames (n_samples - refFrame);	// Position relative to reference frame
-	position = floorfrac (position + relpos);
-	refFrame = 0;
+	updateCpuLoad (n_samples);
+	updateRuntime (n_samples, std::chrono::duration<double> (std::chrono::steady_clock::now () - runStart).count ());
 
 	// Send collected data to GUI
 	if (ui_on)
@@ -686,6 +859,12 @@ void BShapr::run (uint32_t n_samples)
 		for (int i = 0; i < MAXSHAPES; ++i) if (scheduleNotifyShapes[i]) notifyShapeToGui (i);
 		if (message.isScheduled ()) notifyMessageToGui ();
 		if (scheduleNotifyStatus) notifyStatusToGui ();
+		for (int i = 0; i < NR_CONTROLLERS; ++i) if (scheduleNotifyControllers[i]) notifyControllerToGui (i);
+		if (cpuLoadFrames >= CPULOADNOTIFYTIME * rate)
+		{
+			notifyCpuLoadToGui ();
+			notifyRuntimeToGui ();
+		}
 	}
 	lv2_atom_forge_pop (&forge, &notify_frame);
 }
@@ -768,6 +947,95 @@ void BShapr::notifyStatusToGui()
 	scheduleNotifyStatus = false;
 }
 
+void BShapr::notifyControllerToGui (const int nr)
+{
+	// Send patch:Set with the (validated) controller value
+	LV2_Atom_Forge_Frame frame;
+	lv2_atom_forge_frame_time(&forge, 0);
+	lv2_atom_forge_object(&forge, &frame, 0, urids.patch_Set);
+	lv2_atom_forge_key(&forge, urids.patch_property);
+	lv2_atom_forge_urid(&forge, parameterUrids[nr]);
+	lv2_atom_forge_key(&forge, urids.patch_value);
+	lv2_atom_forge_float(&forge, controllers[nr]);
+	lv2_atom_forge_pop(&forge, &frame);
+
+	scheduleNotifyControllers[nr] = false;
+}
+
+void BShapr::notifyCpuLoadToGui()
+{
+	// Send notifications
+	LV2_Atom_Forge_Frame frame;
+	lv2_atom_forge_frame_time(&forge, 0);
+	lv2_atom_forge_object(&forge, &frame, 0, urids.notify_cpuEvent);
+	lv2_atom_forge_key(&forge, urids.notify_cpuLoad);
+	lv2_atom_forge_vector(&forge, sizeof(float), urids.atom_Float, (uint32_t) (2 * MAXSHAPES), &cpuLoad);
+	lv2_atom_forge_pop(&forge, &frame);
+
+	// Restart peak detection
+	std::fill (cpuLoad + MAXSHAPES, cpuLoad + 2 * MAXSHAPES, 0.0f);
+	cpuLoadFrames = 0;
+}
+
+void BShapr::updateCpuLoad (const uint32_t n)
+{
+	if (n == 0) return;
+
+	const double time = n / rate;
+	const float f = time / (time + CPULOADAVERAGETIME);
+
+	for (int sh = 0; sh < MAXSHAPES; ++sh)
+	{
+		const float load = cycleCounter.toSeconds (shapers[sh].cpuCycles) / time;
+		cpuLoad[sh] += f * (load - cpuLoad[sh]);
+
+		// Sampled costs of runs shorter than the sample interval are too coarse for peaks
+		if ((n >= CPULOADSAMPLEINTERVAL) && (load > cpuLoad[MAXSHAPES + sh])) cpuLoad[MAXSHAPES + sh] = load;
+
+		shapers[sh].cpuCycles = 0;
+	}
+
+	cpuLoadFrames += n;
+}
+
+void BShapr::notifyRuntimeToGui()
+{
+	// Send notifications
+	LV2_Atom_Forge_Frame frame;
+	lv2_atom_forge_frame_time(&forge, 0);
+	lv2_atom_forge_object(&forge, &frame, 0, urids.notify_runtimeEvent);
+	lv2_atom_forge_key(&forge, urids.notify_runtimeHistogram);
+	lv2_atom_forge_vector(&forge, sizeof(int32_t), urids.atom_Int, (uint32_t) (RUNTIMEHISTOGRAMSIZE), &runtimeHistogram);
+	lv2_atom_forge_key(&forge, urids.notify_runtimeOverloads);
+	lv2_atom_forge_vector(&forge, sizeof(int32_t), urids.atom_Int, (uint32_t) (RUNTIMEOVERLOADSIZE), &runtimeOverloads);
+	lv2_atom_forge_key(&forge, urids.notify_runtimeThreshold);
+	lv2_atom_forge_float(&forge, runtimeThreshold);
+	lv2_atom_forge_pop(&forge, &frame);
+}
+
+// Counters saturate instead of overflowing in long sessions
+static inline void saturatingIncrement (int32_t& counter) {if (counter < INT32_MAX) ++counter;}
+
+void BShapr::updateRuntime (const uint32_t n, const double seconds)
+{
+	if (n == 0) return;
+
+	const double load = seconds * rate / n;
+	int exponent = 0;
+	if (load > 0.0) frexp (load, &exponent);
+	const int bin = (load > 0.0 ? LIM (exponent + 11, 0, RUNTIMEHISTOGRAMSIZE - 1) : 0);
+	saturatingIncrement (runtimeHistogram[bin]);
+
+	if (load > runtimeThreshold)
+	{
+		saturatingIncrement (runtimeOverloads[0]);
+		for (int i = PITCH_SEARCH_EVENT; i < RUNTIMEOVERLOADSIZE; ++i)
+		{
+			if (runtimeEvents & (1 << i)) saturatingIncrement (runtimeOverloads[i]);
+		}
+	}
+}
+
 void BShapr::audioLevel (const float input1, const float input2, float* output1, float* output2, const float amp)
 {
 	*output1 = input1 * LIM (amp, methods[LEVEL].limit.min, methods[LEVEL].limit.max);
@@ -801,7 +1069,7 @@ void BShapr::stereoWidth (const float input1, const float input2, float* output1
 }
 
 // Butterworth algorithm
-void BShapr::lowPassFilter (const float input1, const float input2, float* output1, float* output2, const float cutoffFreq, const int shape)
+TARGET_CLONES void BShapr::lowPassFilter (const float input1, const float input2, float* output1, float* output2, const float cutoffFreq, const int shape)
 {
 	int order = controllers[SHAPERS + shape * SH_SIZE + SH_OPTION + DB_PER_OCT_OPT] / 6;
 	float f = LIM (cutoffFreq, methods[LOW_PASS].limit.min, methods[LOW_PASS].limit.max);
@@ -826,14 +1094,14 @@ void BShapr::lowPassFilter (const float input1, const float input2, float* outpu
 	double f2 = input2;
 	for (int i = 0; i < int (order / 2); ++i)
 	{
-		filter1Buffer0[i] = coeff1[i] * filter1Buffer1[shape][i] + coeff2[i] * filter1Buffer2[shape][i] + f1;
-		filter2Buffer0[i] = coeff1[i] * filter2Buffer1[shape][i] + coeff2[i] * filter2Buffer2[shape][i] + f2;
-		f1 = coeff0[i] * (filter1Buffer0[i] + 2.0f * filter1Buffer1[shape][i] + filter1Buffer2[shape][i]);
-		f2 = coeff0[i] * (filter2Buffer0[i] + 2.0f * filter2Buffer1[shape][i] + filter2Buffer2[shape][i]);
-		filter1Buffer2[shape][i] = filter1Buffer1[shape][i];
-		filter1Buffer1[shape][i] = filter1Buffer0[i];
-		filter2Buffer2[shape][i] = filter2Buffer1[shape][i];
-		filter2Buffer1[shape][i] = filter2Buffer0[i];
+		filter1Buffer0[i] = coeff1[i] * shapers[shape].filter1Buffer1[i] + coeff2[i] * shapers[shape].filter1Buffer2[i] + f1;
+		filter2Buffer0[i] = coeff1[i] * shapers[shape].filter2Buffer1[i] + coeff2[i] * shapers[shape].filter2Buffer2[i] + f2;
+		f1 = coeff0[i] * (filter1Buffer0[i] + 2.0f * shapers[shape].filter1Buffer1[i] + shapers[shape].filter1Buffer2[i]);
+		f2 = coeff0[i] * (filter2Buffer0[i] + 2.0f * shapers[shape].filter2Buffer1[i] + shapers[shape].filter2Buffer2[i]);
+		shapers[shape].filter1Buffer2[i] = shapers[shape].filter1Buffer1[i];
+		shapers[shape].filter1Buffer1[i] = filter1Buffer0[i];
+		shapers[shape].filter2Buffer2[i] = shapers[shape].filter2Buffer1[i];
+		shapers[shape].filter2Buffer1[i] = filter2Buffer0[i];
 	}
 
 	*output1 = f1;
@@ -841,7 +1109,7 @@ void BShapr::lowPassFilter (const float input1, const float input2, float* outpu
 }
 
 // Butterworth algorithm
-void BShapr::highPassFilter (const float input1, const float input2, float* output1, float* output2, const float cutoffFreq, const int shape)
+TARGET_CLONES void BShapr::highPassFilter (const float input1, const float input2, float* output1, float* output2, const float cutoffFreq, const int shape)
 {
 	int order = controllers[SHAPERS + shape * SH_SIZE + SH_OPTION + DB_PER_OCT_OPT] / 6;
 	float f = LIM (cutoffFreq, methods[HIGH_PASS].limit.min, methods[HIGH_PASS].limit.max);
@@ -866,14 +1134,14 @@ void BShapr::highPassFilter (const float input1, const float input2, float* outp
 	double f2 = input2;
 	for (int i = 0; i < int (order / 2); ++i)
 	{
-		filter1Buffer0[i] = coeff1[i] * filter1Buffer1[shape][i] + coeff2[i] * filter1Buffer2[shape][i] + f1;
-		filter2Buffer0[i] = coeff1[i] * filter2Buffer1[shape][i] + coeff2[i] * filter2Buffer2[shape][i] + f2;
-		f1 = coeff0[i] * (filter1Buffer0[i] - 2.0f * filter1Buffer1[shape][i] + filter1Buffer2[shape][i]);
-		f2 = coeff0[i] * (filter2Buffer0[i] - 2.0f * filter2Buffer1[shape][i] + filter2Buffer2[shape][i]);
-		filter1Buffer2[shape][i] = filter1Buffer1[shape][i];
-		filter1Buffer1[shape][i] = filter1Buffer0[i];
-		filter2Buffer2[shape][i] = filter2Buffer1[shape][i];
-		filter2Buffer1[shape][i] = filter2Buffer0[i];
+		filter1Buffer0[i] = coeff1[i] * shapers[shape].filter1Buffer1[i] + coeff2[i] * shapers[shape].filter1Buffer2[i] + f1;
+		filter2Buffer0[i] = coeff1[i] * shapers[shape].filter2Buffer1[i] + coeff2[i] * shapers[shape].filter2Buffer2[i] + f2;
+		f1 = coeff0[i] * (filter1Buffer0[i] - 2.0f * shapers[shape].filter1Buffer1[i] + shapers[shape].filter1Buffer2[i]);
+		f2 = coeff0[i] * (filter2Buffer0[i] - 2.0f * shapers[shape].filter2Buffer1[i] + shapers[shape].filter2Buffer2[i]);
+		shapers[shape].filter1Buffer2[i] = shapers[shape].filter1Buffer1[i];
+		shapers[shape].filter1Buffer1[i] = filter1Buffer0[i];
+		shapers[shape].filter2Buffer2[i] = shapers[shape].filter2Buffer1[i];
+		shapers[shape].filter2Buffer1[i] = filter2Buffer0[i];
 	}
 
 	*output1 = f1;
@@ -887,8 +1155,8 @@ void BShapr::pitch (const float input1, const float input2, float* output1, floa
 	const int pitchFaderSize = rate * PITCHFADERTIME / 1000;
 	const float p  = LIM (semitone, methods[PITCH].limit.min, methods[PITCH].limit.max);
 	const double pitchFactor = pow (2, p / 12);
-	const uint32_t wPtr = audioBuffer1[shape].wPtr1;
-	const double rPtr = audioBuffer1[shape].rPtr1;
+	const uint32_t wPtr = shapers[shape].audioBuffer1.wPtr1;
+	const double rPtr = shapers[shape].audioBuffer1.rPtr1;
 	const uint32_t rPtrInt = uint32_t (rPtr);
 	const double rPtrFrac = fmod (rPtr, 1);
 	double diff = rPtr - wPtr;
@@ -896,12 +1164,12 @@ void BShapr::pitch (const float input1, const float input2, float* output1, floa
 	if (diff < -pitchBufferSize / 2) diff = diff + pitchBufferSize;
 
 	// Write to buffers and output
-	audioBuffer1[shape].frames[wPtr % pitchBufferSize] = input1;
-	audioBuffer2[shape].frames[wPtr % pitchBufferSize] = input2;
-	*output1 = (1 - rPtrFrac) * audioBuffer1[shape].frames[rPtrInt % pitchBufferSize] +
-						 rPtrFrac * audioBuffer1[shape].frames[(rPtrInt + 1) % pitchBufferSize];
-	*output2 = (1 - rPtrFrac) * audioBuffer2[shape].frames[rPtrInt % pitchBufferSize] +
-						 rPtrFrac * audioBuffer2[shape].frames[(rPtrInt + 1) % pitchBufferSize];
+	shapers[shape].audioBuffer1.frames[wPtr % pitchBufferSize] = input1;
+	shapers[shape].audioBuffer2.frames[wPtr % pitchBufferSize] = input2;
+	*output1 = (1 - rPtrFrac) * shapers[shape].audioBuffer1.frames[rPtrInt % pitchBufferSize] +
+						 rPtrFrac * shapers[shape].audioBuffer1.frames[(rPtrInt + 1) % pitchBufferSize];
+	*output2 = (1 - rPtrFrac) * shapers[shape].audioBuffer2.frames[rPtrInt % pitchBufferSize] +
+						 rPtrFrac * shapers[shape].audioBuffer2.frames[(rPtrInt + 1) % pitchBufferSize];
 
 	// Update pointers
  	const double newWPtr = (wPtr + 1) % pitchBufferSize;
@@ -916,6 +1184,7 @@ void BShapr::pitch (const float input1, const float input2, float* output1, floa
 	if (((diff < 0) && (newDiff >= 0) && (p > 0)) ||
 			((diff >= 1) && (newDiff < 1) && (p < 0)))
 	{
+		runtimeEvents |= (1 << PITCH_SEARCH_EVENT);
 		int sig = (p > 0 ? -1 : 1);
 		double bestOverlayScore = 9999;
 		int bestI = 0;
@@ -927,17 +1196,17 @@ void BShapr::pitch (const float input1, const float input2, float* output1, floa
 		{
 			double jpos = double (pitchBufferSize * (1 << j)) / 1000;
 			uint32_t jptr = rPtrInt + pitchBufferSize + sig * jpos;
-			slope11[j] = audioBuffer1[shape].frames[(jptr + 1) % pitchBufferSize] -
-									 audioBuffer1[shape].frames[jptr % pitchBufferSize];
-			slope12[j] = audioBuffer2[shape].frames[(jptr + 1) % pitchBufferSize] -
-									 audioBuffer2[shape].frames[jptr % pitchBufferSize];
+			slope11[j] = shapers[shape].audioBuffer1.frames[(jptr + 1) % pitchBufferSize] -
+									 shapers[shape].audioBuffer1.frames[jptr % pitchBufferSize];
+			slope12[j] = shapers[shape].audioBuffer2.frames[(jptr + 1) % pitchBufferSize] -
+									 shapers[shape].audioBuffer2.frames[jptr % pitchBufferSize];
 		}
 
 		// Iterate through the buffer to find the best match
 		for (int i = pitchFaderSize + 1; i < pitchBufferSize - pitchFaderSize; ++i)
 		{
-			double posDiff1 = audioBuffer1[shape].frames[rPtrInt % pitchBufferSize] - audioBuffer1[shape].frames[(rPtrInt + i) % pitchBufferSize];
-			double posDiff2 = audioBuffer2[shape].frames[rPtrInt % pitchBufferSize] - audioBuffer2[shape].frames[(rPtrInt + i) % pitchBufferSize];
+			double posDiff1 = shapers[shape].audioBuffer1.frames[rPtrInt % pitchBufferSize] - shapers[shape].audioBuffer1.frames[(rPtrInt + i) % pitchBufferSize];
+			double posDiff2 = shapers[shape].audioBuffer2.frames[rPtrInt % pitchBufferSize] - shapers[shape].audioBuffer2.frames[(rPtrInt + i) % pitchBufferSize];
 			double overlayScore = SQR (posDiff1) + SQR (posDiff2);
 
 			for (int j = 0; j < P_ORDER; ++j)
@@ -946,10 +1215,10 @@ void BShapr::pitch (const float input1, const float input2, float* output1, floa
 
 				double jpos = double (pitchBufferSize * (1 << j)) / 1000;
 				uint32_t jptr = rPtrInt + pitchBufferSize + i + sig * jpos;
-				double slope21 = audioBuffer1[shape].frames[(jptr + 1) % pitchBufferSize] -
-												 audioBuffer1[shape].frames[jptr % pitchBufferSize];
-				double slope22 = audioBuffer2[shape].frames[(jptr + 1) % pitchBufferSize] -
-												 audioBuffer2[shape].frames[jptr % pitchBufferSize];
+				double slope21 = shapers[shape].audioBuffer1.frames[(jptr + 1) % pitchBufferSize] -
+												 shapers[shape].audioBuffer1.frames[jptr % pitchBufferSize];
+				double slope22 = shapers[shape].audioBuffer2.frames[(jptr + 1) % pitchBufferSize] -
+												 shapers[shape].audioBuffer2.frames[jptr % pitchBufferSize];
 				double slopeDiff1 = slope11[j] - slope21;
 				double slopeDiff2 = slope12[j] - slope22;
 				overlayScore += SQR (slopeDiff1) + SQR (slopeDiff2);
@@ -965,10 +1234,10 @@ void BShapr::pitch (const float input1, const float input2, float* output1, floa
 		newRPtr = fmod (rPtr + bestI + pitchFactor, pitchBufferSize);
 	}
 
-	audioBuffer1[shape].wPtr1 = newWPtr;
-	audioBuffer1[shape].rPtr1 = newRPtr;
-	audioBuffer2[shape].wPtr1 = newWPtr;
-	audioBuffer2[shape].rPtr1 = newRPtr;
+	shapers[shape].audioBuffer1.wPtr1 = newWPtr;
+	shapers[shape].audioBuffer1.rPtr1 = newRPtr;
+	shapers[shape].audioBuffer2.wPtr1 = newWPtr;
+	shapers[shape].audioBuffer2.rPtr1 = newRPtr;
 }
 
 // Ring buffer method with least squares ring closure
@@ -979,16 +1248,16 @@ void BShapr::delay (const float input1, const float input2, float* output1, floa
 	float param = LIM (delaytime, methods[DELAY].limit.min, methods[DELAY].limit.max) * rate / 1000;
 	const int delayframes = LIM (param, 0, audioBufferSize);
 
-	const uint32_t wPtr = uint32_t (audioBuffer1[shape].wPtr1) % audioBufferSize;
-	const uint32_t rPtr1 = uint32_t (audioBuffer1[shape].rPtr1) % audioBufferSize;
-	const uint32_t rPtr2 = uint32_t (audioBuffer1[shape].rPtr2) % audioBufferSize;
+	const uint32_t wPtr = uint32_t (shapers[shape].audioBuffer1.wPtr1) % audioBufferSize;
+	const uint32_t rPtr1 = uint32_t (shapers[shape].audioBuffer1.rPtr1) % audioBufferSize;
+	const uint32_t rPtr2 = uint32_t (shapers[shape].audioBuffer1.rPtr2) % audioBufferSize;
 	const int diff = (rPtr2 > rPtr1 ? rPtr2 - rPtr1 : rPtr2 + audioBufferSize - rPtr1);
 
 	// Write to buffers and output
-	audioBuffer1[shape].frames[wPtr] = input1;
-	audioBuffer2[shape].frames[wPtr] = input2;
-	*output1 = audioBuffer1[shape].frames[rPtr2];
-	*output2 = audioBuffer2[shape].frames[rPtr2];
+	shapers[shape].audioBuffer1.frames[wPtr] = input1;
+	shapers[shape].audioBuffer2.frames[wPtr] = input2;
+	*output1 = shapers[shape].audioBuffer1.frames[rPtr2];
+	*output2 = shapers[shape].audioBuffer2.frames[rPtr2];
 
 	// Update pointers
 	uint32_t newRPtr1 = rPtr1;
@@ -997,6 +1266,7 @@ void BShapr::delay (const float input1, const float input2, float* output1, floa
 	// End of block? Find best point to continue.
 	if (diff >= delayBufferSize)
 	{
+		runtimeEvents |= (1 << DELAY_SEARCH_EVENT);
 		double bestOverlayScore = 9999;
 		int bestI = 0;
 
@@ -1007,18 +1277,18 @@ void BShapr::delay (const float input1, const float input2, float* output1, floa
 		{
 			double jpos = double (delayBufferSize * (1 << j)) / 1000;
 			uint32_t jptr = rPtr2 + audioBufferSize - jpos;
-			slope11[j] = audioBuffer1[shape].frames[(jptr + 1) % audioBufferSize] -
-									 audioBuffer1[shape].frames[jptr % audioBufferSize];
-			slope12[j] = audioBuffer2[shape].frames[(jptr + 1) % audioBufferSize] -
-									 audioBuffer2[shape].frames[jptr % audioBufferSize];
+			slope11[j] = shapers[shape].audioBuffer1.frames[(jptr + 1) % audioBufferSize] -
+									 shapers[shape].audioBuffer1.frames[jptr % audioBufferSize];
+			slope12[j] = shapers[shape].audioBuffer2.frames[(jptr + 1) % audioBufferSize] -
+									 shapers[shape].audioBuffer2.frames[jptr % audioBufferSize];
 		}
 
 		// Iterate through the buffer to find the best match
 		for (int i = 0; (i < delayBufferSize) && (i < delayframes); ++i)
 		{
 			int32_t iPtr = (wPtr + 2 * audioBufferSize - delayframes - i) % audioBufferSize;
-			double posDiff1 = audioBuffer1[shape].frames[rPtr2] - audioBuffer1[shape].frames[iPtr];
-			double posDiff2 = audioBuffer2[shape].frames[rPtr2] - audioBuffer2[shape].frames[iPtr];
+			double posDiff1 = shapers[shape].audioBuffer1.frames[rPtr2] - shapers[shape].audioBuffer1.frames[iPtr];
+			double posDiff2 = shapers[shape].audioBuffer2.frames[rPtr2] - shapers[shape].audioBuffer2.frames[iPtr];
 			double overlayScore = SQR (posDiff1) + SQR (posDiff2);
 
 			for (int j = 0; j < P_ORDER; ++j)
@@ -1027,10 +1297,10 @@ void BShapr::delay (const float input1, const float input2, float* output1, floa
 
 				double jpos = double (delayBufferSize * (1 << j)) / 1000;
 				uint32_t jptr = iPtr + audioBufferSize - jpos;
-				double slope21 = audioBuffer1[shape].frames[(jptr + 1) % audioBufferSize] -
-												 audioBuffer1[shape].frames[jptr % audioBufferSize];
-				double slope22 = audioBuffer2[shape].frames[(jptr + 1) % audioBufferSize] -
-												 audioBuffer2[shape].frames[jptr % audioBufferSize];
+				double slope21 = shapers[shape].audioBuffer1.frames[(jptr + 1) % audioBufferSize] -
+												 shapers[shape].audioBuffer1.frames[jptr % audioBufferSize];
+				double slope22 = shapers[shape].audioBuffer2.frames[(jptr + 1) % audioBufferSize] -
+												 shapers[shape].audioBuffer2.frames[jptr % audioBufferSize];
 				double slopeDiff1 = slope11[j] - slope21;
 				double slopeDiff2 = slope12[j] - slope22;
 				overlayScore += SQR (slopeDiff1) + SQR (slopeDiff2);
@@ -1048,12 +1318,12 @@ void BShapr::delay (const float input1, const float input2, float* output1, floa
 	}
 
 	// Write back pointers
-	audioBuffer1[shape].wPtr1 = (wPtr + 1) % audioBufferSize;
-	audioBuffer2[shape].wPtr1 = audioBuffer1[shape].wPtr1;
-	audioBuffer1[shape].rPtr1 = newRPtr1;
-	audioBuffer2[shape].rPtr1 = newRPtr1;
-	audioBuffer1[shape].rPtr2 = (newRPtr2 + 1) % audioBufferSize;
-	audioBuffer2[shape].rPtr2 = audioBuffer1[shape].rPtr2;
+	shapers[shape].audioBuffer1.wPtr1 = (wPtr + 1) % audioBufferSize;
+	shapers[shape].audioBuffer2.wPtr1 = shapers[shape].audioBuffer1.wPtr1;
+	shapers[shape].audioBuffer1.rPtr1 = newRPtr1;
+	shapers[shape].audioBuffer2.rPtr1 = newRPtr1;
+	shapers[shape].audioBuffer1.rPtr2 = (newRPtr2 + 1) % audioBufferSize;
+	shapers[shape].audioBuffer2.rPtr2 = shapers[shape].audioBuffer1.rPtr2;
 }
 
 // Delay with Doppler effect
@@ -1063,23 +1333,23 @@ void BShapr::doppler (const float input1, const float input2, float* output1, fl
 	float param = LIM (delaytime, methods[DELAY].limit.min, methods[DELAY].limit.max) * rate / 1000;
 	const float delayframes = LIM (param, 0, audioBufferSize);
 
-	const uint32_t wPtr = uint32_t (audioBuffer1[shape].wPtr1) % audioBufferSize;
-	const uint32_t rPtrInt = uint32_t (audioBuffer1[shape].rPtr1) % audioBufferSize;
-	const double rPtrFrac = fmod (audioBuffer1[shape].rPtr1, 1);
+	const uint32_t wPtr = uint32_t (shapers[shape].audioBuffer1.wPtr1) % audioBufferSize;
+	const uint32_t rPtrInt = uint32_t (shapers[shape].audioBuffer1.rPtr1) % audioBufferSize;
+	const double rPtrFrac = fmod (shapers[shape].audioBuffer1.rPtr1, 1);
 
 	// Write to buffers and output
-	audioBuffer1[shape].frames[wPtr] = input1;
-	audioBuffer2[shape].frames[wPtr] = input2;
-	*output1 = (1 - rPtrFrac) * audioBuffer1[shape].frames[rPtrInt] +
-						 rPtrFrac * audioBuffer1[shape].frames[(rPtrInt + 1) % audioBufferSize];
-	*output2 = (1 - rPtrFrac) * audioBuffer2[shape].frames[rPtrInt] +
-						 rPtrFrac * audioBuffer2[shape].frames[(rPtrInt + 1) % audioBufferSize];
+	shapers[shape].audioBuffer1.frames[wPtr] = input1;
+	shapers[shape].audioBuffer2.frames[wPtr] = input2;
+	*output1 = (1 - rPtrFrac) * shapers[shape].audioBuffer1.frames[rPtrInt] +
+						 rPtrFrac * shapers[shape].audioBuffer1.frames[(rPtrInt + 1) % audioBufferSize];
+	*output2 = (1 - rPtrFrac) * shapers[shape].audioBuffer2.frames[rPtrInt] +
+						 rPtrFrac * shapers[shape].audioBuffer2.frames[(rPtrInt + 1) % audioBufferSize];
 
 	// Update pointers
-	audioBuffer1[shape].wPtr1 = (wPtr + 1) % audioBufferSize;
-	audioBuffer2[shape].wPtr1 = audioBuffer1[shape].wPtr1;
-	audioBuffer1[shape].rPtr1 = fmod (audioBuffer1[shape].wPtr1 + audioBufferSize - delayframes, audioBufferSize);
-	audioBuffer2[shape].rPtr1 = audioBuffer1[shape].rPtr1;
+	shapers[shape].audioBuffer1.wPtr1 = (wPtr + 1) % audioBufferSize;
+	shapers[shape].audioBuffer2.wPtr1 = shapers[shape].audioBuffer1.wPtr1;
+	shapers[shape].audioBuffer1.rPtr1 = fmod (shapers[shape].audioBuffer1.wPtr1 + audioBufferSize - delayframes, audioBufferSize);
+	shapers[shape].audioBuffer2.rPtr1 = shapers[shape].audioBuffer1.rPtr1;
 }
 
 void BShapr::distortion (const float input1, const float input2, float* output1, float* output2, const int mode, const float drive, const float limit)
@@ -1126,18 +1396,18 @@ void BShapr::distortion (const float input1, const float input2, float* output1,
 void BShapr::decimate (const float input1, const float input2, float* output1, float* output2, const float hz, const int shape)
 {
 	const double f = LIM (hz, methods[DECIMATE].limit.min, methods[DECIMATE].limit.max);
-	if (decimateCounter[shape] + 1 >= double (rate) / f)
+	if (shapers[shape].decimateCounter + 1 >= double (rate) / f)
 	{
-		decimateBuffer1[shape] = input1;
-		decimateBuffer2[shape] = input2;
-		float c0 = double (rate) / f - decimateCounter[shape];
-		decimateCounter[shape] = (c0 > 0 ? c0 : 0);
+		shapers[shape].decimateBuffer1 = input1;
+		shapers[shape].decimateBuffer2 = input2;
+		float c0 = double (rate) / f - shapers[shape].decimateCounter;
+		shapers[shape].decimateCounter = (c0 > 0 ? c0 : 0);
 	}
 
-	else decimateCounter[shape]++;
+	else shapers[shape].decimateCounter++;
 
-	*output1 = decimateBuffer1[shape];
-	*output2 = decimateBuffer2[shape];
+	*output1 = shapers[shape].decimateBuffer1;
+	*output2 = shapers[shape].decimateBuffer2;
 }
 
 void BShapr::bitcrush (const float input1, const float input2, float* output1, float* output2, const float bitNr)
@@ -1167,7 +1437,7 @@ void BShapr::sendMidi (const float input1, const float input2, float* output1, f
 	uint8_t newValue = amp * 128;
 	newValue = LIM (newValue, 0, 127);
 
-	if (newValue != sendValue[shape])
+	if (newValue != shapers[shape].sendValue)
 	{
 		LV2_Atom midiatom;
 		midiatom.type = urids.midi_Event;
@@ -1186,7 +1456,7 @@ void BShapr::sendMidi (const float input1, const float input2, float* output1, f
 			lv2_atom_forge_raw (&forge, &msg, 3);
 			lv2_atom_forge_pad (&forge, sizeof (LV2_Atom) + 3);
 		}
-		sendValue[shape] = newValue;
+		shapers[shape].sendValue = newValue;
 	}
 }
 #endif
@@ -1210,11 +1480,59 @@ void BShapr::play (uint32_t start, uint32_t end)
 	}
 #endif
 
-	for (uint32_t i = start; i < end; ++i)
+	// Process in chunks fitting into the factor buffers
+	for (uint32_t chunkStart = start; chunkStart < end; chunkStart += FACTORBUFFERSIZE)
+	{
+		const uint32_t chunkEnd = (end - chunkStart > FACTORBUFFERSIZE ? chunkStart + FACTORBUFFERSIZE : end);
+		const uint32_t n = chunkEnd - chunkStart;
+
+		// Spread a pending phase correction, max. PHASECORRECTIONRATE of the increment
+		const double maxCorrection = n * fabs (increment) * PHASECORRECTIONRATE;
+		const double correction = LIM (phaseCorrection, -maxCorrection, maxCorrection);
+		const double inc = increment + correction / n;
+		phaseCorrection -= correction;
+
+		updateFactors (chunkStart, chunkEnd, phase, inc);
+		playFrames (chunkStart, chunkEnd, phase, inc);
+		phase = floorfrac (phase + n * inc);
+	}
+}
+
+void BShapr::updateFactors (const uint32_t start, const uint32_t end, const double startPos, const double inc)
+{
+	// Shapers are only calculated (and their factors only proceed) if not
+	// bypassed and if MIDI-independent or key pressed
+	if ((controllers[BYPASS] != 0.0f) || ((controllers[MIDI_CONTROL] != 0.0f) && (key == 0xFF))) return;
+
+	const bool stopped = (((speed == 0.0f) && (controllers[BASE] != SECONDS)) || (bpm < 1.0f));
+	float targets[FACTORBUFFERSIZE];
+
+	for (int sh = 0; sh < MAXSHAPES; ++sh)
+	{
+		if (controllers[SHAPERS + sh * SH_SIZE + SH_INPUT] == BShaprInputIndex::OFF) continue;
+
+		const uint64_t startCycles = readCycles ();
+
+		// Keep last value while transport is stopped
+		if (stopped) shapers[sh].factor.hold (shapers[sh].factorBuffer, end - start);
+
+		// Get shaper values for the actual positions and smooth them
+		else
+		{
+			shapes[sh].getMapValues (startPos, inc, targets, end - start);
+			shapers[sh].factor.proceed (targets, shapers[sh].factorBuffer, end - start);
+		}
+
+		shapers[sh].cpuCycles += readCycles () - startCycles;
+	}
+}
+
+void BShapr::playFrames (const uint32_t start, const uint32_t end, const double startPos, const double inc)
+{
+	double pos = startPos;	// 0..1 position
+
+	for (uint32_t i = start; i < end; ++i, pos = floorfrac (pos + inc))
 	{
-		// Interpolate position within the loop
-		double relpos = getPositionFromFrames (i - refFrame);	// Position relative to reference frame
-		double pos = floorfrac (position + relpos);		// 0..1 position
 
 		float output1 = 0;
 		float output2 = 0;
@@ -1236,10 +1554,17 @@ void BShapr::play (uint32_t start, uint32_t end)
 			float shapeOutput2[MAXSHAPES];
 			memset (shapeOutput2, 0, MAXSHAPES * sizeof (float));
 
+			// The shapers are processed frame by frame. Thus their costs are
+			// only measured for each CPULOADSAMPLEINTERVAL-th frame
+			const bool measure = (cpuLoadCountdown == 0);
+			cpuLoadCountdown = (measure ? CPULOADSAMPLEINTERVAL - 1 : cpuLoadCountdown - 1);
+
 			for (int sh = 0; sh < MAXSHAPES; ++sh)
 			{
 				if (controllers[SHAPERS + sh * SH_SIZE + SH_INPUT] != BShaprInputIndex::OFF)
 				{
+					const uint64_t startCycles = (measure ? readCycles () : 0);
+
 					// Connect to shaper input
 					switch (int (controllers[SHAPERS + sh * SH_SIZE + SH_INPUT]))
 					{
@@ -1268,14 +1593,8 @@ void BShapr::play (uint32_t start, uint32_t end)
 							}
 					}
 
-					// Get shaper value for the actual position
-					float iFactor = 0.0f;
-					if (((speed == 0.0f) && (controllers[BASE] != SECONDS)) || (bpm < 1.0f)) iFactor = factors[sh].getValue();
-					else 
-					{
-						factors[sh].setTarget (shapes[sh].getMapValue (pos));
-						iFactor = factors[sh].proceed();
-					}
+					// Get (smoothed) shaper value for the actual position
+					const float iFactor = shapers[sh].factorBuffer[i - start];
 
 					float drywet = controllers[SHAPERS + sh * SH_SIZE + SH_DRY_WET];
 					float wet1 = 0;
@@ -1376,6 +1695,8 @@ void BShapr::play (uint32_t start, uint32_t end)
 						output1 += shapeOutput1[sh] * controllers[SHAPERS + sh * SH_SIZE + SH_OUTPUT_AMP];
 						output2 += shapeOutput2[sh] * controllers[SHAPERS + sh * SH_SIZE + SH_OUTPUT_AMP];
 					}
+
+					if (measure) shapers[sh].cpuCycles += (readCycles () - startCycles) * CPULOADSAMPLEINTERVAL;
 				}
 			}
 		}
@@ -1452,6 +1773,15 @@ LV2_State_Status BShapr::state_save (LV2_State_Store_Function store, LV2_State_H
 	}
 	store (handle, urids.state_shape, shapesDataString, strlen (shapesDataString) + 1, urids.atom_String, LV2_STATE_IS_POD);
 
+	// Parameters set by patch:Set and not overridden by the port since
+	for (int i = 0; i < NR_CONTROLLERS; ++i)
+	{
+		if (isParameterController (i) && (controllers[i] != portValues[i]))
+		{
+			store (handle, parameterUrids[i], &controllers[i], sizeof (float), urids.atom_Float, LV2_STATE_IS_POD);
+		}
+	}
+
 	return LV2_STATE_SUCCESS;
 }
 
@@ -1570,6 +1900,26 @@ LV2_State_Status BShapr::state_restore (LV2_State_Retrieve_Function retrieve, LV
 		for (int i = 0; i < MAXSHAPES; ++i) scheduleNotifyShapes[i] = true;
 	}
 
+	// Parameters: Restore stored values, otherwise fall back to the port
+	for (int i = 0; i < NR_CONTROLLERS; ++i)
+	{
+		if (!isParameterController (i)) continue;
+
+		const void* parameterData = retrieve (handle, parameterUrids[i], &size, &type, &valflags);
+		if (parameterData && (type == urids.atom_Float) && (size == sizeof (float)))
+		{
+			setController (i, *((const float*) parameterData));
+			parameterRestored[i] = true;
+			scheduleNotifyControllers[i] = true;
+		}
+
+		else if (controllers[i] != portValues[i])
+		{
+			setController (i, portValues[i]);
+			scheduleNotifyControllers[i] = true;
+		}
+	}
+
 	return LV2_STATE_SUCCESS;
 }
 
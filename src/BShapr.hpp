@@ -38,6 +38,9 @@
 #include "Shape.hpp"
 #include "BShaprNotifications.hpp"
 #include "ACE/ACEReverb.hpp"
+#include "CycleCounter.hpp"
+#include "TargetClones.hpp"
+#include "Capture.hpp"
 
 
 #define MAX_F_ORDER 12
@@ -47,6 +50,27 @@
 #define DELAYBUFFERTIME 20
 #define MINOPTIONVALUE -20000
 #define MAXOPTIONVALUE 20000
+#define CACHELINESIZE 64
+#define FACTORBUFFERSIZE 256
+#define PHASESYNCFRAMES 32
+#define PHASECORRECTIONRATE 0.01
+#define CPULOADSAMPLEINTERVAL 16
+#define CPULOADAVERAGETIME 1.0
+#define CPULOADNOTIFYTIME 0.25
+#define RUNTIMEHISTOGRAMSIZE 16
+#define RUNTIMEOVERLOADSIZE 4
+#define RUNTIMETHRESHOLD 0.5
+
+// Expensive events within a run () which may push it over the real-time
+// budget. Also the indexes (except NO_RUNTIME_EVENT) of the causes counted
+// in runtimeOverloads.
+enum RuntimeEvent
+{
+	NO_RUNTIME_EVENT	= 0,
+	PITCH_SEARCH_EVENT	= 1,	// Pitch shifter ring closure search
+	DELAY_SEARCH_EVENT	= 2,	// Delay ring closure search
+	SHAPE_RENDER_EVENT	= 3	// Full shape received and re-rendered
+};
 
 struct AudioBuffer
 {
@@ -80,22 +104,46 @@ class Fader
 public:
 	Fader ();
 	Fader (const float value, const float speed);
-	void setTarget (const float target);
 	void setSpeed (const float speed);
-	float proceed ();
+	void proceed (const float* targets, float* values, const uint32_t n);
+	void hold (float* values, const uint32_t n) const;
 	float getValue () const;
 
 protected:
 	float value;
-	float target;
 	float speed;
 };
 
+// Per-shaper state touched by the audio loop for each frame. Kept in one
+// cache line aligned block per shaper. Rarely touched per-shaper data (shapes,
+// tempNodes, reverbs) stay in separate arrays of BShapr.
+struct alignas (CACHELINESIZE) ShaperState
+{
+	ShaperState ();
+	void resetFilters (const float value);
+
+	Fader factor;
+	float factorBuffer [FACTORBUFFERSIZE];
+	float filter1Buffer1 [MAX_F_ORDER / 2];
+	float filter1Buffer2 [MAX_F_ORDER / 2];
+	float filter2Buffer1 [MAX_F_ORDER / 2];
+	float filter2Buffer2 [MAX_F_ORDER / 2];
+	float decimateBuffer1;
+	float decimateBuffer2;
+	double decimateCounter;
+	AudioBuffer audioBuffer1;
+	AudioBuffer audioBuffer2;
+	uint8_t sendValue;
+	uint64_t cpuCycles;
+};
+
 class BShapr
 {
 public:
 	BShapr (double samplerate, const LV2_Feature* const* features);
 	~BShapr();
+	static void* operator new (size_t size);
+	static void operator delete (void* ptr);
 	void connect_port (uint32_t port, void *data);
 	void run (uint32_t n_samples);
 	LV2_State_Status state_save(LV2_State_Store_Function store, LV2_State_Handle handle, uint32_t flags, const LV2_Feature* const* features);
@@ -104,7 +152,7 @@ public:
 	LV2_URID_Map* map;
 
 private:
-	void fillFilterBuffer (float filterBuffer[MAXSHAPES] [MAX_F_ORDER / 2], const float value);
+	void resetFilters (const float value);
 	bool isAudioOutputConnected (int shapeNr);
 	void audioLevel (const float input1, const float input2, float* output1, float* output2, const float amp);
 	void stereoBalance (const float input1, const float input2, float* output1, float* output2, const float balance);
@@ -127,13 +175,23 @@ private:
 	void reverb (const float input1, const float input2, float* output1, float* output2, const float roomsz, const int shape);
 
 	void play(uint32_t start, uint32_t end);
+	void updateFactors (const uint32_t start, const uint32_t end, const double startPos, const double inc);
+	void playFrames (const uint32_t start, const uint32_t end, const double startPos, const double inc);
 	void notifyMonitorToGui ();
 	void notifyShapeToGui (int shapeNr);
 	void notifyMessageToGui ();
 	void notifyStatusToGui ();
+	void notifyControllerToGui (const int nr);
+	void notifyCpuLoadToGui ();
+	void updateCpuLoad (const uint32_t n);
+	void notifyRuntimeToGui ();
+	void updateRuntime (const uint32_t n, const double seconds);
 	double getPositionFromBeats (double beats);
-	double getPositionFromFrames (uint64_t frames);
 	double getPositionFromSeconds (double seconds);
+	void setController (const int i, const float value);
+	bool isTimedEvent (const LV2_Atom_Event* ev) const;
+	void updateIncrement ();
+	void syncPhase (const double pos);
 
 	double rate;
 	float bpm;
@@ -143,36 +201,32 @@ private:
 	float beatsPerBar;
 	uint32_t beatUnit;
 
-	double position;
+	// Position within the loop (0..1) at the next frame to play
+	double phase;
 	double offset;
-	uint64_t refFrame;
+	double increment;
+	double phaseCorrection;
 
 	// Audio buffers
 	float* audioInput1;
 	float* audioInput2;
 	float* audioOutput1;
 	float* audioOutput2;
-	AudioBuffer audioBuffer1 [MAXSHAPES];
-	AudioBuffer audioBuffer2 [MAXSHAPES];
-	float filter1Buffer1 [MAXSHAPES] [MAX_F_ORDER / 2];
-	float filter1Buffer2 [MAXSHAPES] [MAX_F_ORDER / 2];
-	float filter2Buffer1 [MAXSHAPES] [MAX_F_ORDER / 2];
-	float filter2Buffer2 [MAXSHAPES] [MAX_F_ORDER / 2];
-	float decimateBuffer1 [MAXSHAPES];
-	float decimateBuffer2 [MAXSHAPES];
-	double decimateCounter [MAXSHAPES];
-	AceReverb reverbs [MAXSHAPES];
-	uint8_t sendValue [MAXSHAPES];
 
-	Fader factors[MAXSHAPES];
+	// Hot per-shaper state
+	ShaperState shapers[MAXSHAPES];
 
 	// Controllers
 	float* new_controllers[NR_CONTROLLERS];
 	float controllers [NR_CONTROLLERS];
+	float portValues [NR_CONTROLLERS];		// Last values read from the ports
+	LV2_URID parameterUrids [NR_CONTROLLERS];	// patch:Set properties
+	bool parameterRestored [NR_CONTROLLERS];	// Not overridden by the next port read
 
 	// Nodes and Maps
 	Shape<MAXNODES> shapes[MAXSHAPES];
 	StaticArrayList<Node, MAXNODES> tempNodes[MAXSHAPES];
+	AceReverb reverbs [MAXSHAPES];
 
 	// Atom port
 	BShaprURIDs urids;
@@ -203,6 +257,27 @@ private:
 	std::array<BShaprNotifications, NOTIFYBUFFERSIZE> notifications;
 	bool scheduleNotifyShapes[MAXSHAPES];
 	bool scheduleNotifyStatus;
+	bool scheduleNotifyControllers[NR_CONTROLLERS];	// Changed by patch:Set
+
+	// DSP load per shaper (fraction of the real time)
+	CycleCounter cycleCounter;
+	uint32_t cpuLoadCountdown;
+	uint32_t cpuLoadFrames;
+	float cpuLoad[2 * MAXSHAPES];	// Rolling averages followed by the peaks
+
+	// run () time relative to the real-time budget of the block. Bin i of the
+	// histogram counts runs taking 2^(i-12) .. 2^(i-11) of the budget (first
+	// and last bin open: < 1/2048, >= 8). runtimeOverloads counts the runs
+	// above runtimeThreshold, followed by the runs above it with a
+	// RuntimeEvent. Both are collected in each run () since instantiation, but
+	// only sent (cumulative, saturating at INT32_MAX) while the GUI is on.
+	uint32_t runtimeEvents;
+	float runtimeThreshold;
+	int32_t runtimeHistogram[RUNTIMEHISTOGRAMSIZE];
+	int32_t runtimeOverloads[RUNTIMEOVERLOADSIZE];
+
+	// Opt-in capture of the control input (see BSHAPR_CAPTURE)
+	Capture* capture;
 
 };
 
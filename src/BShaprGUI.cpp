@@ -22,7 +22,7 @@
 
 BShaprGUI::BShaprGUI (const char *bundlePath, const LV2_Feature *const *features, PuglNativeView parentWindow) :
 	Window (1200, 710, "B.Shapr", parentWindow, true, PUGL_MODULE, 0),
-	controller (NULL), write_function (NULL),
+	trace (), controller (NULL), write_function (NULL),
 	bpm (120), beatsPerBar (4.0), beatUnit (4),
 
 	mContainer (0, 0, 1200, 710, "widget"),
@@ -37,19 +37,25 @@ BShaprGUI::BShaprGUI (const char *bundlePath, const LV2_Feature *const *features
 	monitorContainer (24, 134, 1152, 352, "monitor"),
 	monitorHorizon1 (0, 0, 0, 64, 352, "horizon"),
 	monitorHorizon2 (-1152, 0, 0, 64, 352, "horizon"),
-	input1Monitor (0, 0, 1152, 176, "monitor.in"),
-	output1Monitor (0, 0, 1152, 176, "monitor.out"),
-	input2Monitor (0, 176, 1152, 176, "monitor.in"),
-	output2Monitor (0, 176, 1152, 176, "monitor.out"),
+	monitor (0, 0, 1152, 352, "monitor.graph"),
+	input1Channel (monitor.addChannel (0.0, 0.5, "monitor.in")),
+	output1Channel (monitor.addChannel (0.0, 0.5, "monitor.out")),
+	input2Channel (monitor.addChannel (0.5, 0.5, "monitor.in")),
+	output2Channel (monitor.addChannel (0.5, 0.5, "monitor.out")),
 
 	shapeBuffer {0.0},
-	horizonPos (0), monitorScale (0.25), minorXSteps (1.0), majorXSteps (1.0),
+	horizonPos (0), monitorPendingStart (0), monitorPendingEnd (0), monitorPendingCount (0),
+	monitorUpdateTime (std::chrono::steady_clock::now ()),
+	monitorScale (0.25), minorXSteps (1.0), majorXSteps (1.0),
 	clipboard (),
 	pluginPath (bundlePath ? std::string (bundlePath) : std::string ("")),
 	sz (1.0),
 	bgImageSurface (nullptr), forge (), urids (), map (NULL)
 
 {
+	std::chrono::steady_clock::time_point traceT0 = trace.now ();
+	trace.add ("members", trace.getCreated (), traceT0);
+
 	// Init shapes
 	for (int i = 0; i < MAXSHAPES; ++i)
 	{
@@ -75,13 +81,11 @@ BShaprGUI::BShaprGUI (const char *bundlePath, const LV2_Feature *const *features
 				}
 			}
 
-			shapeGui[i].methodIcons.push_back (BWidgets::ImageIcon (0, 0, 154, 54, "icon", std::vector<std::string>{iconPath, iconPath}));
+			shapeGui[i].methodIcons.push_back (BWidgets::ImageIcon (0, 0, 154, 54, "icon"));
 
 			BWidgets::ImageIcon* icon = &*std::prev (shapeGui[i].methodIcons.end ());
-			cairo_t* cr = cairo_create (icon->getIconSurface (BColors::NORMAL));
-			cairo_set_source_rgba (cr, 0.0, 0.0, 0.0, 0.5);
-			cairo_paint (cr);
-			cairo_destroy (cr);
+			icon->loadImage (BColors::NORMAL, iconPath, 0.5);
+			icon->loadImage (BColors::ACTIVE, iconPath);
 
 			il.push_back (BItems::Item (index, icon));
 		}
@@ -100,6 +104,7 @@ BShaprGUI::BShaprGUI (const char *bundlePath, const LV2_Feature *const *features
 		shapeGui[i].gridSelect = SelectWidget (1043, 368, 104, 44, "tool", 44, 44, 2, 2, {"Show grid", "Snap to grid"});
 		shapeGui[i].drywetLabel = BWidgets::Label (500, 494, 50, 16, "smlabel", "dry/wet");
 		shapeGui[i].drywetDial = BWidgets::DialValue (500, 434, 50, 60, "dial", 1.0, 0.0, 1.0, 0, "%1.2f");
+		shapeGui[i].cpuLabel = BWidgets::Label (570, 494, 160, 16, "smlabel", "");
 
 		for (int j = 0; j < MAXOPTIONS; ++j)
 		{
@@ -154,11 +159,17 @@ BShaprGUI::BShaprGUI (const char *bundlePath, const LV2_Feature *const *features
 		}
 	}
 
+	std::chrono::steady_clock::time_point traceT1 = trace.now ();
+	trace.add ("shapes", traceT0, traceT1);
+	traceT0 = traceT1;
+
 	// Init main monitor
 	initMonitors ();
 
 	// Link controller widgets
 	controllerWidgets.fill (nullptr);
+	parameterEchoPending.fill (false);
+	parameterEchoValues.fill (0.0);
 	controllerWidgets[BYPASS] = (BWidgets::ValueWidget*) &bypassButton;
 	controllerWidgets[DRY_WET] = (BWidgets::ValueWidget*) &drywetDial;
 	controllerWidgets[MIDI_CONTROL] = (BWidgets::ValueWidget*) &midiTriggerSwitch;
@@ -222,10 +233,7 @@ BShaprGUI::BShaprGUI (const char *bundlePath, const LV2_Feature *const *features
 	midiPiano.pressKeys (keys);
 	midiPiano.hide();
 	monitorContainer.setScrollable (true);
-	input1Monitor.setScrollable (false);
-	output1Monitor.setScrollable (false);
-	input2Monitor.setScrollable (false);
-	output2Monitor.setScrollable (false);
+	monitor.setScrollable (false);
 	shapeGui[0].tabContainer.rename ("activetab");
 	for (unsigned int i = 0; i < MAXSHAPES; ++i)
 	{
@@ -250,14 +258,14 @@ BShaprGUI::BShaprGUI (const char *bundlePath, const LV2_Feature *const *features
 		shapeGui[i].shapeContainer.setScrollable (false);
 		if (i >= 1) shapeGui[i].shapeContainer.hide ();
 	}
+	traceT1 = trace.now ();
+	trace.add ("configure", traceT0, traceT1);
 	applyChildThemes ();
 	getKeyGrabStack()->add (this);
+	traceT0 = trace.now ();
 
 	// Pack widgets
-	monitorContainer.add (input1Monitor);
-	monitorContainer.add (output1Monitor);
-	monitorContainer.add (input2Monitor);
-	monitorContainer.add (output2Monitor);
+	monitorContainer.add (monitor);
 	monitorContainer.add (monitorHorizon1);
 	monitorContainer.add (monitorHorizon2);
 	mContainer.add (monitorContainer);
@@ -270,6 +278,7 @@ BShaprGUI::BShaprGUI (const char *bundlePath, const LV2_Feature *const *features
 		shapeGui[i].shapeContainer.add (shapeGui[i].smoothingDial);
 		shapeGui[i].shapeContainer.add (shapeGui[i].drywetLabel);
 		shapeGui[i].shapeContainer.add (shapeGui[i].drywetDial);
+		shapeGui[i].shapeContainer.add (shapeGui[i].cpuLabel);
 		shapeGui[i].shapeContainer.add (shapeGui[i].shapeWidget);
 		shapeGui[i].shapeContainer.add (shapeGui[i].toolSelect);
 		for (int j = 0; j < 7; ++j) shapeGui[i].shapeContainer.add (shapeGui[i].editWidgets[j]);
@@ -312,9 +321,11 @@ BShaprGUI::BShaprGUI (const char *bundlePath, const LV2_Feature *const *features
 	//Map URIS
 	map = m;
 	mapURIDs (map, &urids);
+	for (int i = 0; i < NR_CONTROLLERS; ++i) parameterUrids[i] = map->map (map->handle, getControllerUri (i).c_str ());
 
 	// Initialize forge
 	lv2_atom_forge_init (&forge, map);
+	trace.add ("pack", traceT0, trace.now ());
 }
 
 BShaprGUI::~BShaprGUI()
@@ -360,17 +371,10 @@ void BShaprGUI::portEvent(uint32_t port, uint32_t bufferSize, uint32_t format, c
 							int p1 = LIMIT (pos.first, 0, MONITORBUFFERSIZE - 1);
 							int p2 = LIMIT (pos.second, 0, MONITORBUFFERSIZE - 1);
 
-							if (p1 <= p2)
-							{
-								updateMonitors (p1, p2);
-								updateHorizon ();
-							}
-							else
-							{
-								updateMonitors (p1, MONITORBUFFERSIZE - 1);
-								updateMonitors (0, p2);
-								updateHorizon ();
-							}
+							// Collect the updated range, redrawn frame-paced by updateFrame ()
+							if (monitorPendingCount == 0) monitorPendingStart = p1;
+							monitorPendingEnd = p2;
+							monitorPendingCount += (p2 - p1 + MONITORBUFFERSIZE) % MONITORBUFFERSIZE + 1;
 						}
 					}
 				}
@@ -433,6 +437,33 @@ void BShaprGUI::portEvent(uint32_t port, uint32_t bufferSize, uint32_t format, c
 				}
 			}
 
+			// DSP load notification: Averages and peaks of all shapers
+			else if (obj->body.otype == urids.notify_cpuEvent)
+			{
+				const LV2_Atom* data = NULL;
+				lv2_atom_object_get(obj, urids.notify_cpuLoad, &data, 0);
+				if (data && (data->type == urids.atom_Vector))
+				{
+					const LV2_Atom_Vector* vec = (const LV2_Atom_Vector*) data;
+					if ((vec->body.child_type == urids.atom_Float) && (data->size - sizeof(LV2_Atom_Vector_Body) == 2 * MAXSHAPES * sizeof (float)))
+					{
+						const float* load = (const float*) (&vec->body + 1);
+						for (int i = 0; i < MAXSHAPES; ++i)
+						{
+							const bool active = (controllers[SHAPERS + i * SH_SIZE + SH_INPUT] != OFF);
+							shapeGui[i].cpuLabel.setText
+							(
+								active ?
+								"DSP " + BUtilities::to_string (100.0 * load[i], "%1.1f") +
+								" % (peak " + BUtilities::to_string (100.0 * load[MAXSHAPES + i], "%1.1f") + " %)" :
+								""
+							);
+						}
+					}
+				}
+				else std::cerr << "BShapr.lv2#GUI: Corrupt DSP load message." << std::endl;
+			}
+
 			// Shape notification
 			else if (obj->body.otype == urids.notify_shapeEvent)
 			{
@@ -467,6 +498,32 @@ void BShaprGUI::portEvent(uint32_t port, uint32_t bufferSize, uint32_t format, c
 					}
 				}
 			}
+
+			// Controller changed by patch:Set: Show like a port event, but
+			// don't write the value back to the port
+			else if (obj->body.otype == urids.patch_Set)
+			{
+				LV2_Atom *oProperty = NULL, *oValue = NULL;
+				lv2_atom_object_get (obj, urids.patch_property, &oProperty, urids.patch_value, &oValue, 0);
+
+				if (oProperty && (oProperty->type == urids.atom_URID) && oValue && (oValue->type == urids.atom_Float))
+				{
+					const LV2_URID property = ((LV2_Atom_URID*)oProperty)->body;
+					float value = ((LV2_Atom_Float*)oValue)->body;
+					int nr = 0;
+					while ((nr < NR_CONTROLLERS) && (parameterUrids[nr] != property)) ++nr;
+					if (nr < NR_CONTROLLERS)
+					{
+						const double oldValue = (controllerWidgets[nr] ? controllerWidgets[nr]->getValue () : 0.0);
+						portEvent (CONTROLLERS + nr, sizeof (float), 0, &value);
+						if (controllerWidgets[nr] && (controllerWidgets[nr]->getValue () != oldValue))
+						{
+							parameterEchoPending[nr] = true;
+							parameterEchoValues[nr] = controllerWidgets[nr]->getValue ();
+						}
+					}
+				}
+			}
 		}
 	}
 
@@ -574,6 +631,8 @@ void BShaprGUI::updateTabs ()
 
 void BShaprGUI::resizeGUI(const double sz)
 {
+	const std::chrono::steady_clock::time_point traceT0 = trace.now ();
+
 	hide ();
 
 	// Resize Fonts
@@ -602,10 +661,7 @@ void BShaprGUI::resizeGUI(const double sz)
 	monitorHorizon1.setHeight (352 * sz);
 	monitorHorizon2.setHeight (352 * sz);
 
-	RESIZE (input1Monitor, 0, 0, 1152, 176, sz);
-	RESIZE (output1Monitor, 0, 0, 1152, 176, sz);
-	RESIZE (input2Monitor, 0, 176, 1152, 176, sz);
-	RESIZE (output2Monitor, 0, 176, 1152, 176, sz);
+	RESIZE (monitor, 0, 0, 1152, 352, sz);
 	for (int i = 0; i < MAXSHAPES; ++i)
 	{
 		RESIZE (shapeGui[i].tabContainer, 20 + i * 148, 90, 147, 40, sz);
@@ -633,6 +689,7 @@ void BShaprGUI::resizeGUI(const double sz)
 		shapeGui[i].targetListBox.resizeListBoxItems (BUtilities::Point (174 * sz - 20, 54 * sz));
 		RESIZE (shapeGui[i].drywetLabel, 500, 494, 50, 16, sz);
 		RESIZE (shapeGui[i].drywetDial, 500, 434, 50, 60, sz);
+		RESIZE (shapeGui[i].cpuLabel, 570, 494, 160, 16, sz);
 		RESIZE (shapeGui[i].shapeWidget, 4, 4, 1152, 352, sz);
 		RESIZE (shapeGui[i].toolSelect, 133, 368, 284, 44, sz);
 		shapeGui[i].toolSelect.resizeSelection (44 * sz, 44 * sz);
@@ -700,10 +757,13 @@ void BShaprGUI::resizeGUI(const double sz)
 	// Apply changes
 	applyChildThemes ();
 	show ();
+	trace.add ("resize", traceT0, trace.now ());
 }
 
 void BShaprGUI::applyChildThemes ()
 {
+	const std::chrono::steady_clock::time_point traceT0 = trace.now ();
+
 	mContainer.applyTheme (theme);
 	messageLabel.applyTheme (theme);
 	bypassButton.applyTheme (theme);
@@ -714,10 +774,7 @@ void BShaprGUI::applyChildThemes ()
 	baseValueSelect.applyTheme (theme);
 	baseListBox.applyTheme (theme);
 	monitorContainer.applyTheme (theme);
-	input1Monitor.applyTheme (theme);
-	output1Monitor.applyTheme (theme);
-	input2Monitor.applyTheme (theme);
-	output2Monitor.applyTheme (theme);
+	monitor.applyTheme (theme);
 	for (unsigned int i = 0; i < MAXSHAPES; ++i)
 	{
 		shapeGui[i].shapeContainer.applyTheme (theme);
@@ -731,6 +788,7 @@ void BShaprGUI::applyChildThemes ()
 		shapeGui[i].targetListBox.applyTheme (theme);
 		shapeGui[i].drywetLabel.applyTheme (theme);
 		shapeGui[i].drywetDial.applyTheme (theme);
+		shapeGui[i].cpuLabel.applyTheme (theme);
 		shapeGui[i].shapeWidget.applyTheme (theme);
 		shapeGui[i].toolSelect.applyTheme (theme);
 		for (int j = 0; j < 7; ++j) shapeGui[i].editWidgets[j].applyTheme (theme);
@@ -747,6 +805,8 @@ void BShaprGUI::applyChildThemes ()
 			}
 		}
 	}
+
+	trace.add ("apply_themes", traceT0, trace.now ());
 }
 
 void BShaprGUI::onConfigureRequest (BEvents::ExposeEvent* event)
@@ -1321,7 +1381,12 @@ void BShaprGUI::valueChangedCallback (BEvents::Event* event)
 					}
 				}
 				ui->controllers[widgetNr] = value;
-				ui->write_function(ui->controller, CONTROLLERS + widgetNr, sizeof(float), 0, &ui->controllers[widgetNr]);
+
+				// Values set by a DSP patch:Set are not written to the port.
+				// Otherwise the host would record them as port automation.
+				const bool echo = ui->parameterEchoPending[widgetNr] && (widget->getValue () == ui->parameterEchoValues[widgetNr]);
+				ui->parameterEchoPending[widgetNr] = false;
+				if (!echo) ui->write_function(ui->controller, CONTROLLERS + widgetNr, sizeof(float), 0, &ui->controllers[widgetNr]);
 			}
 		}
 	}
@@ -1560,10 +1625,7 @@ void BShaprGUI::wheelScrolledCallback (BEvents::Event* event)
 
 			ui->monitorScale = ui->monitorScale * (1 + 0.01 * we->getDelta().y);
 			if (ui->monitorScale < 0.01) ui->monitorScale = 0.01;
-			ui->input1Monitor.setZoom (ui->monitorScale);
-			ui->output1Monitor.setZoom (ui->monitorScale);
-			ui->input2Monitor.setZoom (ui->monitorScale);
-			ui->output2Monitor.setZoom (ui->monitorScale);
+			ui->monitor.setZoom (ui->monitorScale);
 		}
 	}
 }
@@ -1629,11 +1691,9 @@ void BShaprGUI::calculateXSteps ()
 
 void BShaprGUI::initMonitors ()
 {
-	input1Monitor.clear ();
-	output1Monitor.clear ();
-	input2Monitor.clear ();
-	output2Monitor.clear ();
+	monitor.clear ();
 	horizonPos = 0;
+	monitorPendingCount = 0;
 }
 
 std::pair<int, int> BShaprGUI::translateNotification (BShaprNotifications* notifications, uint32_t notificationsCount)
@@ -1646,10 +1706,10 @@ std::pair<int, int> BShaprGUI::translateNotification (BShaprNotifications* notif
 	{
 		monitorpos = LIMIT (notifications[i].position, 0, MONITORBUFFERSIZE - 1);
 
-		input1Monitor.addData (monitorpos, notifications[i].input1);
-		output1Monitor.addData (monitorpos, notifications[i].output1);
-		input2Monitor.addData (monitorpos, notifications[i].input2);
-		output2Monitor.addData (monitorpos, notifications[i].output2);
+		monitor.addData (input1Channel, monitorpos, notifications[i].input1);
+		monitor.addData (output1Channel, monitorpos, notifications[i].output1);
+		monitor.addData (input2Channel, monitorpos, notifications[i].input2);
+		monitor.addData (output2Channel, monitorpos, notifications[i].output2);
 
 		horizonPos = double (monitorpos) / MONITORBUFFERSIZE;
 	}
@@ -1658,10 +1718,39 @@ std::pair<int, int> BShaprGUI::translateNotification (BShaprNotifications* notif
 
 void BShaprGUI::updateMonitors (int start, int end)
 {
-	input1Monitor.redrawRange (start, end);
-	output1Monitor.redrawRange (start, end);
-	input2Monitor.redrawRange (start, end);
-	output2Monitor.redrawRange (start, end);
+	monitor.redrawRange (start, end);
+}
+
+void BShaprGUI::traceFirstFrame ()
+{
+	if ((!trace.isEnabled ()) || (getFrameCount () == 0)) return;
+
+	const std::chrono::steady_clock::time_point t = trace.now ();
+	const std::chrono::duration<double> decodeTime (BWidgets::ImageCache::getDecodeTime ());
+	trace.add ("png_decode", trace.getStart (), trace.getStart () + std::chrono::duration_cast<std::chrono::steady_clock::duration> (decodeTime));
+	trace.add ("first_frame", trace.getStart (), t);
+	trace.dump ();
+}
+
+void BShaprGUI::updateFrame ()
+{
+	if (monitorPendingCount == 0) return;
+
+	// Limit monitor and horizon updates to GUI_MAXFPS, independent of the
+	// rate of the monitor notifications
+	std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now ();
+	if (now - monitorUpdateTime < std::chrono::microseconds (1000000 / GUI_MAXFPS)) return;
+	monitorUpdateTime = now;
+
+	if (monitorPendingCount >= MONITORBUFFERSIZE) updateMonitors (0, MONITORBUFFERSIZE - 1);
+	else if (monitorPendingStart <= monitorPendingEnd) updateMonitors (monitorPendingStart, monitorPendingEnd);
+	else
+	{
+		updateMonitors (monitorPendingStart, MONITORBUFFERSIZE - 1);
+		updateMonitors (0, monitorPendingEnd);
+	}
+	updateHorizon ();
+	monitorPendingCount = 0;
 }
 
 void BShaprGUI::updateHorizon ()
@@ -1709,6 +1798,7 @@ static LV2UI_Handle instantiate (const LV2UI_Descriptor *descriptor, const char
 	if (parentWindow == 0) std::cerr << "BShapr.lv2#GUI: No parent window.\n";
 
 	// New instance
+	const std::chrono::steady_clock::time_point traceT0 = GuiTrace::now ();
 	BShaprGUI* ui;
 	try {ui = new BShaprGUI (bundle_path, features, parentWindow);}
 	catch (std::exception& exc)
@@ -1717,6 +1807,9 @@ static LV2UI_Handle instantiate (const LV2UI_Descriptor *descriptor, const char
 		return NULL;
 	}
 
+	ui->trace.setStart (traceT0);
+	ui->trace.add ("window", traceT0, ui->trace.getCreated ());
+	ui->trace.add ("constructor", traceT0, GuiTrace::now ());
 	ui->controller = controller;
 	ui->write_function = write_function;
 
@@ -1730,6 +1823,7 @@ static LV2UI_Handle instantiate (const LV2UI_Descriptor *descriptor, const char
 	if (resize) resize->ui_resize (resize->handle, 1200 * sz, 710 * sz);
 	*widget = (LV2UI_Widget) puglGetNativeWindow (ui->getPuglView ());
 	ui->sendGuiOn();
+	ui->trace.add ("instantiate", traceT0, GuiTrace::now ());
 
 	return (LV2UI_Handle) ui;
 }
@@ -1750,7 +1844,12 @@ static void portEvent(LV2UI_Handle ui, uint32_t port_index, uint32_t buffer_size
 static int callIdle (LV2UI_Handle ui)
 {
 	BShaprGUI* pluginGui = (BShaprGUI*) ui;
-	if (pluginGui) pluginGui->handleEvents ();
+	if (pluginGui)
+	{
+		pluginGui->updateFrame ();
+		pluginGui->handleEvents ();
+		pluginGui->traceFirstFrame ();
+	}
 	return 0;
 }
 
@@ -27,6 +27,7 @@
 #include <cmath>
 #include <exception>
 #include <utility>
+#include <chrono>
 #include <lv2/lv2plug.in/ns/lv2core/lv2.h>
 #include <lv2/lv2plug.in/ns/extensions/ui/ui.h>
 #include <lv2/lv2plug.in/ns/ext/atom/atom.h>
@@ -51,14 +52,19 @@
 #include "SymbolWidget.hpp"
 #include "EditWidget.hpp"
 #include "LightButton.hpp"
+#include "BUtilities/to_string.hpp"
 #include "Globals.hpp"
 #include "Urids.hpp"
 #include "BShaprNotifications.hpp"
+#include "GuiTrace.hpp"
 
 #include "screen.h"
 #include "SelectWidget.hpp"
 
 #define BG_FILE "inc/surface.png"
+#ifndef GUI_MAXFPS
+#define GUI_MAXFPS 30
+#endif
 #define RESIZE(widget, x, y, w, h, sz) {(widget).moveTo ((x) * (sz), (y) * (sz)); (widget).resize ((w) * (sz), (h) * (sz));}
 
 const std::string messageStrings[MAXMESSAGES] =
@@ -80,12 +86,15 @@ public:
 	void sendGuiOn ();
 	void sendGuiOff ();
 	void sendShape (size_t shapeNr);
+	void updateFrame ();
+	void traceFirstFrame ();
 	virtual void onConfigureRequest (BEvents::ExposeEvent* event) override;
 	virtual void onCloseRequest (BEvents::WidgetEvent* event) override;
 	virtual void onKeyPressed (BEvents::KeyEvent* event) override;
 	virtual void onKeyReleased (BEvents::KeyEvent* event) override;
 	void applyChildThemes ();
 
+	GuiTrace trace;
 	LV2UI_Controller controller;
 	LV2UI_Write_Function write_function;
 
@@ -117,6 +126,12 @@ private:
 	// Controllers
 	std::array<BWidgets::ValueWidget*, NR_CONTROLLERS> controllerWidgets;
 	std::array<float, NR_CONTROLLERS> controllers;
+	std::array<LV2_URID, NR_CONTROLLERS> parameterUrids;	// patch:Set properties
+
+	// Widget values set from a DSP patch:Set. These are not written back to
+	// the ports (see valueChangedCallback ()).
+	std::array<bool, NR_CONTROLLERS> parameterEchoPending;
+	std::array<double, NR_CONTROLLERS> parameterEchoValues;
 
 	float bpm;
 	float beatsPerBar;
@@ -136,6 +151,7 @@ private:
 		BWidgets::PopupListBox targetListBox;
 		BWidgets::Label drywetLabel;
 		BWidgets::DialValue drywetDial;
+		BWidgets::Label cpuLabel;
 		ShapeWidget shapeWidget;
 		std::list<BWidgets::ImageIcon> methodIcons;
 		std::array<BWidgets::ValueWidget*, MAXOPTIONS> optionWidgets;
@@ -157,15 +173,20 @@ private:
 	BWidgets::Widget monitorContainer;
 	HorizonWidget monitorHorizon1;
 	HorizonWidget monitorHorizon2;
-	MonitorWidget input1Monitor;
-	MonitorWidget output1Monitor;
-	MonitorWidget input2Monitor;
-	MonitorWidget output2Monitor;
+	MonitorWidget monitor;
+	int input1Channel;
+	int output1Channel;
+	int input2Channel;
+	int output2Channel;
 	std::array<ShapeGui, MAXSHAPES> shapeGui;
 
 	float shapeBuffer[MAXNODES * 7];
 
 	double horizonPos;
+	int monitorPendingStart;
+	int monitorPendingEnd;
+	int monitorPendingCount;
+	std::chrono::steady_clock::time_point monitorUpdateTime;
 	double monitorScale;
 	double minorXSteps;
 	double majorXSteps;
@@ -19,6 +19,9 @@
 #define BEVENTS_HPP_
 
 #include <cstdint>
+#include <cstddef>
+#include <new>
+#include <mutex>
 #include <string>
 #include "BDevices.hpp"
 #include "../BUtilities/Any.hpp"
@@ -57,6 +60,104 @@ enum EventType
 	NO_EVENT
 };
 
+#define BEVENTS_POOLGRANULARITY 16
+#define BEVENTS_POOLBUCKETS 16
+#define BEVENTS_POOLMAXBLOCKS 1024
+
+/**
+ * Class BEvents::EventPool
+ *
+ * Recycles the memory of released event objects. Blocks are kept in free
+ * lists sorted by size (up to BEVENTS_POOLBUCKETS x BEVENTS_POOLGRANULARITY
+ * bytes) and thus the allocation of event objects doesn't call the heap
+ * once the pool has got enough blocks.
+ */
+class EventPool
+{
+public:
+	static void* allocate (const size_t size)
+	{
+		const size_t bucket = (size + BEVENTS_POOLGRANULARITY - 1) / BEVENTS_POOLGRANULARITY;
+		if ((bucket == 0) || (bucket > BEVENTS_POOLBUCKETS)) return ::operator new (size);
+
+		Pool& pool = getPool ();
+		{
+			std::lock_guard<std::mutex> lock (pool.mutex);
+			Block* block = pool.freeBlocks[bucket - 1];
+			if (block)
+			{
+				pool.freeBlocks[bucket - 1] = block->next;
+				--pool.nrBlocks[bucket - 1];
+				return block;
+			}
+		}
+
+		return ::operator new (bucket * BEVENTS_POOLGRANULARITY);
+	}
+
+	static void release (void* ptr, const size_t size)
+	{
+		if (!ptr) return;
+
+		const size_t bucket = (size + BEVENTS_POOLGRANULARITY - 1) / BEVENTS_POOLGRANULARITY;
+		if ((bucket == 0) || (bucket > BEVENTS_POOLBUCKETS))
+		{
+			::operator delete (ptr);
+			return;
+		}
+
+		Pool& pool = getPool ();
+		{
+			std::lock_guard<std::mutex> lock (pool.mutex);
+			if (pool.nrBlocks[bucket - 1] < BEVENTS_POOLMAXBLOCKS)
+			{
+				Block* block = (Block*) ptr;
+				block->next = pool.freeBlocks[bucket - 1];
+				pool.freeBlocks[bucket - 1] = block;
+				++pool.nrBlocks[bucket - 1];
+				return;
+			}
+		}
+
+		::operator delete (ptr);
+	}
+
+private:
+	struct Block
+	{
+		Block* next;
+	};
+
+	struct Pool
+	{
+		Block* freeBlocks[BEVENTS_POOLBUCKETS] = {};
+		size_t nrBlocks[BEVENTS_POOLBUCKETS] = {};
+		std::mutex mutex;
+
+		~Pool ()
+		{
+			for (Block* block : freeBlocks)
+			{
+				while (block)
+				{
+					Block* next = block->next;
+					::operator delete (block);
+					block = next;
+				}
+			}
+		}
+	};
+
+	static Pool& getPool ()
+	{
+		static Pool pool;
+		return pool;
+	}
+};
+/*
+ * End of class BEvents::EventPool
+ *****************************************************************************/
+
 /**
  * Class BEvents::Event
  *
@@ -78,6 +179,13 @@ public:
 
 	virtual ~Event () {}
 
+	/**
+	 * Allocation of events (and all derived event classes) from the
+	 * BEvents::EventPool.
+	 */
+	static void* operator new (size_t size) {return EventPool::allocate (size);}
+	static void operator delete (void* ptr, size_t size) {EventPool::release (ptr, size);}
+
 	/**
 	 * Gets a pointer to the widget which caused the event.
 	 * @return Pointer to the widget
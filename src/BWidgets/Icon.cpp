@@ -32,9 +32,8 @@ Icon::Icon (const Icon& that) : Widget (that)
 	// Copy icons
 	for (cairo_surface_t* s : that.iconSurface)
 	{
-		cairo_surface_t* n = nullptr;
-		if (s) n = cairo_image_surface_clone_from_image_surface (s);
-		iconSurface.push_back (n);
+		// Icon surfaces are read-only and thus shared
+		iconSurface.push_back (s ? cairo_surface_reference (s) : nullptr);
 	}
 }
 
@@ -63,9 +62,8 @@ Icon& Icon::operator= (const Icon& that)
 	// Copy new icons
 	for (cairo_surface_t* s : that.iconSurface)
 	{
-		cairo_surface_t* n = nullptr;
-		if (s) n = cairo_image_surface_clone_from_image_surface (s);
-		iconSurface.push_back (n);
+		// Icon surfaces are read-only and thus shared
+		iconSurface.push_back (s ? cairo_surface_reference (s) : nullptr);
 	}
 
 	return *this;
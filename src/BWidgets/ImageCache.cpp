@@ -0,0 +1,85 @@
+/* ImageCache.cpp
+ * Copyright (C) 2019  Sven Jähnichen
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "ImageCache.hpp"
+#include <map>
+#include <mutex>
+#include <utility>
+#include <chrono>
+#include "cairoplus.h"
+
+namespace BWidgets
+{
+// Owns one reference of each cached surface until the module is unloaded
+struct ImageCacheStore
+{
+	std::map<std::pair<std::string, double>, cairo_surface_t*> surfaces;
+	std::mutex mutex;
+	double decodeTime = 0.0;
+
+	~ImageCacheStore ()
+	{
+		for (std::pair<const std::pair<std::string, double>, cairo_surface_t*>& s : surfaces) cairo_surface_destroy (s.second);
+	}
+};
+
+static ImageCacheStore imageCacheStore;
+
+cairo_surface_t* ImageCache::getImage (const std::string& filename, const double dim)
+{
+	std::lock_guard<std::mutex> lock (imageCacheStore.mutex);
+	return cairo_surface_reference (findOrLoad (filename, dim));
+}
+
+double ImageCache::getDecodeTime ()
+{
+	std::lock_guard<std::mutex> lock (imageCacheStore.mutex);
+	return imageCacheStore.decodeTime;
+}
+
+cairo_surface_t* ImageCache::findOrLoad (const std::string& filename, const double dim)
+{
+	const std::pair<std::string, double> key (filename, dim);
+	std::map<std::pair<std::string, double>, cairo_surface_t*>::iterator it = imageCacheStore.surfaces.find (key);
+	if (it != imageCacheStore.surfaces.end ()) return it->second;
+
+	cairo_surface_t* surface = nullptr;
+	if (dim == 0.0)
+	{
+		const std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now ();
+		surface = cairo_image_surface_create_from_png (filename.c_str());
+		imageCacheStore.decodeTime += std::chrono::duration<double> (std::chrono::steady_clock::now () - t0).count ();
+	}
+	else
+	{
+		// Dimmed variant of the cached image
+		cairo_surface_t* image = findOrLoad (filename, 0.0);
+		if (cairo_surface_status (image) != CAIRO_STATUS_SUCCESS) return image;
+
+		surface = cairo_image_surface_clone_from_image_surface (image);
+		cairo_t* cr = cairo_create (surface);
+		cairo_set_source_rgba (cr, 0.0, 0.0, 0.0, dim);
+		cairo_paint (cr);
+		cairo_destroy (cr);
+	}
+
+	// Also failed loads are cached to not retry them for each widget
+	imageCacheStore.surfaces[key] = surface;
+	return surface;
+}
+
+}
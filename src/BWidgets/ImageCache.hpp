@@ -0,0 +1,58 @@
+/* ImageCache.hpp
+ * Copyright (C) 2019  Sven Jähnichen
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef IMAGECACHE_HPP_
+#define IMAGECACHE_HPP_
+
+#include <string>
+#include <cairo/cairo.h>
+
+namespace BWidgets
+{
+/**
+ * Class BWidgets::ImageCache
+ *
+ * Process-wide cache of decoded image files. The surfaces are shared
+ * between all widgets (and all windows) using the same image file. The
+ * surfaces in the cache are read-only.
+ */
+class ImageCache
+{
+public:
+	/**
+	 * Gets the surface of an image file, decodes the file on its first use.
+	 * @param filename	PNG file name
+	 * @param dim		Opacity of a black layer painted over the image
+	 *			(0.0 .. 1.0)
+	 * @return		New reference to the surface, release by
+	 *			cairo_surface_destroy ()
+	 */
+	static cairo_surface_t* getImage (const std::string& filename, const double dim = 0.0);
+
+	/**
+	 * Gets the total time spent for decoding image files.
+	 * @return		Time in seconds
+	 */
+	static double getDecodeTime ();
+
+private:
+	static cairo_surface_t* findOrLoad (const std::string& filename, const double dim);
+};
+
+}
+
+#endif /* IMAGECACHE_HPP_ */
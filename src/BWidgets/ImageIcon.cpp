@@ -67,6 +67,7 @@ void ImageIcon::loadImage (BColors::State state, cairo_surface_t* surface)
 {
 	// Fill empty states with nullptr
 	while (state >= iconSurface.size ()) iconSurface.push_back (nullptr);
+	if (state < imageFiles.size ()) imageFiles[state].filename = "";
 
 	// Clear old surface
 	if (iconSurface[state] && (cairo_surface_status (iconSurface[state]) == CAIRO_STATUS_SUCCESS))
@@ -75,13 +76,14 @@ void ImageIcon::loadImage (BColors::State state, cairo_surface_t* surface)
 		iconSurface[state] = nullptr;
 	}
 
-	iconSurface[state] = cairo_image_surface_clone_from_image_surface (surface);
+	iconSurface[state] = cairo_surface_reference (surface);
 }
 
-void ImageIcon::loadImage (BColors::State state, const std::string& filename)
+void ImageIcon::loadImage (BColors::State state, const std::string& filename, const double dim)
 {
 	// Fill empty states with nullptr
 	while (state >= iconSurface.size ()) iconSurface.push_back (nullptr);
+	while (state >= imageFiles.size ()) imageFiles.push_back ({"", 0.0});
 
 	// Clear old surface
 	if (iconSurface[state] && (cairo_surface_status (iconSurface[state]) == CAIRO_STATUS_SUCCESS))
@@ -90,7 +92,27 @@ void ImageIcon::loadImage (BColors::State state, const std::string& filename)
 		iconSurface[state] = nullptr;
 	}
 
-	iconSurface[state] = cairo_image_surface_create_from_png (filename.c_str());
+	// Decode on demand
+	imageFiles[state] = {filename, dim};
+}
+
+void ImageIcon::loadImageFiles ()
+{
+	for (unsigned int i = 0; i < imageFiles.size (); ++i)
+	{
+		if (imageFiles[i].filename != "")
+		{
+			if (iconSurface[i]) cairo_surface_destroy (iconSurface[i]);
+			iconSurface[i] = ImageCache::getImage (imageFiles[i].filename, imageFiles[i].dim);
+			imageFiles[i].filename = "";
+		}
+	}
+}
+
+void ImageIcon::draw (const BUtilities::RectArea& area)
+{
+	loadImageFiles ();
+	Icon::draw (area);
 }
 
 }
@@ -19,6 +19,7 @@
 #define IMAGEICON_HPP_
 
 #include "Icon.hpp"
+#include "ImageCache.hpp"
 
 namespace BWidgets
 {
@@ -44,12 +45,28 @@ public:
 	virtual Widget* clone () const override;
 
 	/**
-	 * Loads an image from a Cairo surface or an image file.
+	 * Loads an image from a Cairo surface or an image file. The surface is
+	 * shared with the icon and must not be changed anymore. Image files
+	 * are decoded via the BWidgets::ImageCache when the icon is drawn
+	 * first.
 	 * @param surface	Cairo surface
 	 * @param filename	Filename
+	 * @param dim		Opacity of a black layer painted over the image
 	 */
 	void loadImage (BColors::State state, cairo_surface_t* surface);
-	void loadImage (BColors::State state, const std::string& filename);
+	void loadImage (BColors::State state, const std::string& filename, const double dim = 0.0);
+
+protected:
+	struct ImageFile
+	{
+		std::string filename;
+		double dim;
+	};
+
+	void loadImageFiles ();
+	virtual void draw (const BUtilities::RectArea& area) override;
+
+	std::vector<ImageFile> imageFiles;
 };
 
 }
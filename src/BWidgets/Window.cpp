@@ -34,7 +34,7 @@ Window::Window (const double width, const double height, const std::string& titl
 		keyGrabStack_ (), buttonGrabStack_ (),
 		title_ (title), world_ (NULL), view_ (NULL), nativeWindow_ (nativeWindow),
 		quit_ (false), focused_ (false), pointer_ (),
-		eventQueue_ ()
+		frameCount_ (0), eventQueue_ (), eventQueueHead_ (0), mergeIndex_ ()
 {
 	main_ = this;
 
@@ -89,6 +89,8 @@ cairo_t* Window::getPuglContext ()
 	else return NULL;
 }
 
+unsigned long Window::getFrameCount () const {return frameCount_;}
+
 void Window::run ()
 {
 	while (!quit_) handleEvents();
@@ -114,131 +116,126 @@ void Window::onExposeRequest (BEvents::ExposeEvent* event)
 	}
 }
 
-void Window::addEventToQueue (BEvents::Event* event)
+static bool isMergeableEventType (const BEvents::EventType eventType)
 {
-	// Try to merge with precursor event
-	if
+	return
 	(
-		(event) &&
-		(event->getWidget()) &&
-		(!eventQueue_.empty ()) &&
-		(eventQueue_.back())
-	)
-	{
-		BEvents::EventType eventType = event->getEventType();
+		(eventType == BEvents::CONFIGURE_REQUEST_EVENT) ||
+		(eventType == BEvents::EXPOSE_REQUEST_EVENT) ||
+		(eventType == BEvents::POINTER_MOTION_EVENT) ||
+		(eventType == BEvents::POINTER_DRAG_EVENT) ||
+		(eventType == BEvents::WHEEL_SCROLL_EVENT) ||
+		(eventType == BEvents::VALUE_CHANGED_EVENT)
+	);
+}
 
-		if
-		(
-			(event->getWidget ()->isMergeable(eventType)) &&
-			(
-				(eventType == BEvents::CONFIGURE_REQUEST_EVENT) ||
-				(eventType == BEvents::EXPOSE_REQUEST_EVENT) ||
-				(eventType == BEvents::POINTER_MOTION_EVENT) ||
-				(eventType == BEvents::POINTER_DRAG_EVENT) ||
-				(eventType == BEvents::WHEEL_SCROLL_EVENT) ||
-				(eventType == BEvents::VALUE_CHANGED_EVENT)
-			)
-		)
-		{
-			// Check for mergeable precursor events
-			for (std::deque<BEvents::Event*>::reverse_iterator rit = eventQueue_.rbegin(); rit != eventQueue_.rend(); ++rit)
-			{
-				BEvents::Event* precursor = *rit;
+void Window::addEventToQueue (BEvents::Event* event)
+{
+	if ((!event) || (!event->getWidget()) || (!isMergeableEventType (event->getEventType ())))
+	{
+		eventQueue_.push_back (event);
+		return;
+	}
 
-				if ((precursor->getEventType() == eventType) && (event->getWidget () == precursor->getWidget ()))
-				{
-					// CONFIGURE_EVENT
-					if (eventType == BEvents::CONFIGURE_REQUEST_EVENT)
-					{
-						BEvents::ExposeEvent* firstEvent = (BEvents::ExposeEvent*) precursor;
-						BEvents::ExposeEvent* nextEvent = (BEvents::ExposeEvent*) event;
+	BEvents::EventType eventType = event->getEventType();
 
-						BUtilities::RectArea area = nextEvent->getArea ();
-						firstEvent->setArea (area);
+	// Index entries are kept (set to nullptr if the event is dequeued) to
+	// not allocate in the steady state
+	BEvents::Event*& precursor = mergeIndex_[std::make_pair (event->getWidget (), eventType)];
 
-						delete event;
-						return;
-					}
+	// Try to merge with the last queued event of the same widget and type
+	if (precursor && (event->getWidget ()->isMergeable(eventType)))
+	{
+		// CONFIGURE_EVENT
+		if (eventType == BEvents::CONFIGURE_REQUEST_EVENT)
+		{
+			BEvents::ExposeEvent* firstEvent = (BEvents::ExposeEvent*) precursor;
+			BEvents::ExposeEvent* nextEvent = (BEvents::ExposeEvent*) event;
 
-					// EXPOSE_EVENT
-					if (eventType == BEvents::EXPOSE_REQUEST_EVENT)
-					{
-						BEvents::ExposeEvent* firstEvent = (BEvents::ExposeEvent*) precursor;
-						BEvents::ExposeEvent* nextEvent = (BEvents::ExposeEvent*) event;
+			BUtilities::RectArea area = nextEvent->getArea ();
+			firstEvent->setArea (area);
 
-						BUtilities::RectArea area = firstEvent->getArea ();
-						area.extend (nextEvent->getArea ());
-						firstEvent->setArea (area);
+			delete event;
+			return;
+		}
 
-						delete event;
-						return;
-					}
+		// EXPOSE_EVENT
+		if (eventType == BEvents::EXPOSE_REQUEST_EVENT)
+		{
+			BEvents::ExposeEvent* firstEvent = (BEvents::ExposeEvent*) precursor;
+			BEvents::ExposeEvent* nextEvent = (BEvents::ExposeEvent*) event;
 
+			BUtilities::RectArea area = firstEvent->getArea ();
+			area.extend (nextEvent->getArea ());
+			firstEvent->setArea (area);
 
-					// POINTER_MOTION_EVENT
-					else if (eventType == BEvents::POINTER_MOTION_EVENT)
-					{
-						BEvents::PointerEvent* firstEvent = (BEvents::PointerEvent*) precursor;
-						BEvents::PointerEvent* nextEvent = (BEvents::PointerEvent*) event;
+			delete event;
+			return;
+		}
 
-						firstEvent->setPosition (nextEvent->getPosition ());
-						firstEvent->setDelta (firstEvent->getDelta () + nextEvent->getDelta ());
 
-						delete event;
-						return;
-					}
+		// POINTER_MOTION_EVENT
+		else if (eventType == BEvents::POINTER_MOTION_EVENT)
+		{
+			BEvents::PointerEvent* firstEvent = (BEvents::PointerEvent*) precursor;
+			BEvents::PointerEvent* nextEvent = (BEvents::PointerEvent*) event;
 
-					// POINTER_DRAG_EVENT
-					else if (eventType == BEvents::POINTER_DRAG_EVENT)
-					{
-						BEvents::PointerEvent* firstEvent = (BEvents::PointerEvent*) precursor;
-						BEvents::PointerEvent* nextEvent = (BEvents::PointerEvent*) event;
+			firstEvent->setPosition (nextEvent->getPosition ());
+			firstEvent->setDelta (firstEvent->getDelta () + nextEvent->getDelta ());
 
-						if
-						(
-							(nextEvent->getButton() == firstEvent->getButton()) &&
-							(nextEvent->getOrigin() == firstEvent->getOrigin())
-						)
-						{
-							firstEvent->setPosition (nextEvent->getPosition ());
-							firstEvent->setDelta (firstEvent->getDelta () + nextEvent->getDelta ());
+			delete event;
+			return;
+		}
 
-							delete event;
-							return;
-						}
-					}
+		// POINTER_DRAG_EVENT
+		else if (eventType == BEvents::POINTER_DRAG_EVENT)
+		{
+			BEvents::PointerEvent* firstEvent = (BEvents::PointerEvent*) precursor;
+			BEvents::PointerEvent* nextEvent = (BEvents::PointerEvent*) event;
 
+			if
+			(
+				(nextEvent->getButton() == firstEvent->getButton()) &&
+				(nextEvent->getOrigin() == firstEvent->getOrigin())
+			)
+			{
+				firstEvent->setPosition (nextEvent->getPosition ());
+				firstEvent->setDelta (firstEvent->getDelta () + nextEvent->getDelta ());
 
-					// WHEEL_SCROLL_EVENT
-					else if (eventType == BEvents::WHEEL_SCROLL_EVENT)
-					{
-						BEvents::WheelEvent* firstEvent = (BEvents::WheelEvent*) precursor;
-						BEvents::WheelEvent* nextEvent = (BEvents::WheelEvent*) event;
+				delete event;
+				return;
+			}
+		}
 
-						if (nextEvent->getPosition() == firstEvent->getPosition())
-						{
-							firstEvent->setDelta (firstEvent->getDelta () + nextEvent->getDelta ());
 
-							delete event;
-							return;
-						}
-					}
+		// WHEEL_SCROLL_EVENT
+		else if (eventType == BEvents::WHEEL_SCROLL_EVENT)
+		{
+			BEvents::WheelEvent* firstEvent = (BEvents::WheelEvent*) precursor;
+			BEvents::WheelEvent* nextEvent = (BEvents::WheelEvent*) event;
 
-					// VALUE_CHANGED_EVENT
-					else if (eventType == BEvents::VALUE_CHANGED_EVENT)
-					{
-						BEvents::ValueChangedEvent* firstEvent = (BEvents::ValueChangedEvent*) precursor;
-						BEvents::ValueChangedEvent* nextEvent = (BEvents::ValueChangedEvent*) event;
+			if (nextEvent->getPosition() == firstEvent->getPosition())
+			{
+				firstEvent->setDelta (firstEvent->getDelta () + nextEvent->getDelta ());
 
-						firstEvent->setValue (nextEvent->getValue());
-						delete event;
-						return;
-					}
-				}
+				delete event;
+				return;
 			}
 		}
+
+		// VALUE_CHANGED_EVENT
+		else if (eventType == BEvents::VALUE_CHANGED_EVENT)
+		{
+			BEvents::ValueChangedEvent* firstEvent = (BEvents::ValueChangedEvent*) precursor;
+			BEvents::ValueChangedEvent* nextEvent = (BEvents::ValueChangedEvent*) event;
+
+			firstEvent->setValue (nextEvent->getValue());
+			delete event;
+			return;
+		}
 	}
 
+	precursor = event;
 	eventQueue_.push_back (event);
 }
 
@@ -251,13 +248,26 @@ void Window::handleEvents ()
 	puglUpdate (world_, 0);
 	translateTimeEvent ();
 
-	while (!eventQueue_.empty ())
+	while (eventQueueHead_ < eventQueue_.size ())
 	{
-		BEvents::Event* event = eventQueue_.front ();
-		eventQueue_.pop_front ();
+		BEvents::Event* event = eventQueue_[eventQueueHead_];
+		++eventQueueHead_;
+
+		// Keep the capacity of the drained queue
+		if (eventQueueHead_ >= eventQueue_.size ())
+		{
+			eventQueue_.clear ();
+			eventQueueHead_ = 0;
+		}
 
 		if (event)
 		{
+			if (event->getWidget () && isMergeableEventType (event->getEventType ()))
+			{
+				BEvents::Event*& indexed = mergeIndex_[std::make_pair (event->getWidget (), event->getEventType ())];
+				if (indexed == event) indexed = nullptr;
+			}
+
 			Widget* widget = event->getWidget ();
 			if (widget)
 			{
@@ -664,6 +674,7 @@ PuglStatus Window::translatePuglEvent (PuglView* view, const PuglEvent* puglEven
 				}
 			}
 			cairo_surface_destroy (storageSurface);
+			++w->frameCount_;
 		}
 		break;
 
@@ -743,7 +754,7 @@ void Window::unfocus ()
 
 void Window::purgeEventQueue (Widget* widget)
 {
-	for (std::deque<BEvents::Event*>::iterator it = eventQueue_.begin (); it != eventQueue_.end (); )
+	for (std::vector<BEvents::Event*>::iterator it = eventQueue_.begin () + eventQueueHead_; it != eventQueue_.end (); )
 	{
 		BEvents::Event* event = *it;
 		if
@@ -766,11 +777,25 @@ void Window::purgeEventQueue (Widget* widget)
 			)
 		)
 		{
+			std::unordered_map<MergeKey, BEvents::Event*, MergeKeyHash>::iterator ix = mergeIndex_.find (MergeKey (event->getWidget (), event->getEventType ()));
+			if ((ix != mergeIndex_.end ()) && (ix->second == event)) ix->second = nullptr;
+
 			it = eventQueue_.erase (it);
 			delete event;
 		}
 		else ++it;
 	}
+
+	// Remove the index entries of the purged widget
+	if (widget == nullptr) mergeIndex_.clear ();
+	else
+	{
+		for (std::unordered_map<MergeKey, BEvents::Event*, MergeKeyHash>::iterator it = mergeIndex_.begin (); it != mergeIndex_.end (); )
+		{
+			if (it->first.first == widget) it = mergeIndex_.erase (it);
+			else ++it;
+		}
+	}
 }
 
 }
@@ -22,7 +22,10 @@
 #define BWIDGETS_DEFAULT_WINDOW_BACKGROUND BStyles::blackFill
 
 #include <chrono>
-#include <deque>
+#include <vector>
+#include <unordered_map>
+#include <utility>
+#include <functional>
 #include <list>
 #include "Widget.hpp"
 
@@ -71,6 +74,13 @@ public:
 	 */
 	cairo_t* getPuglContext ();
 
+	/**
+	 * Gets the number of frames shown by the host system since the window
+	 * was created.
+	 * @return Number of frames
+	 */
+	unsigned long getFrameCount () const;
+
 	/**
 	 * Runs the window until the close flag is set and thus it will be closed.
 	 * For stand-alone applications.
@@ -147,8 +157,20 @@ protected:
 	bool quit_;
 	bool focused_;
 	BUtilities::Point pointer_;
-
-	std::deque<BEvents::Event*> eventQueue_;		// TODO: std::list ?
+	unsigned long frameCount_;
+
+	// Event queue. Events before eventQueueHead_ are already dequeued. The
+	// vector is cleared (keeping its capacity) once it is drained.
+	std::vector<BEvents::Event*> eventQueue_;
+	size_t eventQueueHead_;
+
+	// Last queued (mergeable) event for each widget and event type
+	typedef std::pair<Widget*, BEvents::EventType> MergeKey;
+	struct MergeKeyHash
+	{
+		size_t operator() (const MergeKey& key) const {return std::hash<Widget*> () (key.first) ^ (std::hash<int> () (key.second) << 1);}
+	};
+	std::unordered_map<MergeKey, BEvents::Event*, MergeKeyHash> mergeIndex_;
 };
 
 }
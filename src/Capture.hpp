@@ -0,0 +1,233 @@
+/* B.Shapr
+ * Beat / envelope shaper LV2 plugin
+ *
+ * Copyright (C) 2019 by Sven Jähnichen
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#ifndef CAPTURE_HPP_
+#define CAPTURE_HPP_
+
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <stdexcept>
+#include <lv2/lv2plug.in/ns/ext/atom/atom.h>
+#include <lv2/lv2plug.in/ns/ext/urid/urid.h>
+#include <lv2/lv2plug.in/ns/ext/midi/midi.h>
+#include <lv2/lv2plug.in/ns/ext/time/time.h>
+#include <lv2/lv2plug.in/ns/ext/patch/patch.h>
+#include "definitions.hpp"
+#include "ports.h"
+#include "Globals.hpp"
+
+#define CAPTURE_MAGIC "BSCAP1"
+#define CAPTUREQUEUESIZE 0x400000
+#define CAPTUREWRITESIZE 0x10000
+#define CAPTUREWRITEINTERVAL 10
+
+// Capture file format (native endianness):
+//	Header		CAPTURE_MAGIC (incl. terminating zero), double rate,
+//			uint32_t nrControllers, uint32_t nrUris
+//	URID table	nrUris x (uint32_t urid, uint32_t length, char uri[length])
+//	Blocks		CaptureBlockHeader,
+//			nrControllers x CaptureController (changed values only),
+//			control port atom sequence (sequenceSize bytes, incl. its atom header)
+// The URID table contains the URIDs of the capturing host for all URIs the
+// DSP uses to interpret the control port input, followed by the parameter
+// URIs of all controllers.
+
+enum CaptureBlockFlags
+{
+	CAPTURE_GAP	= 1	// Blocks before this block are lost (queue overflow)
+};
+
+struct CaptureBlockHeader
+{
+	uint32_t nSamples;
+	uint32_t nrControllers;
+	uint32_t sequenceSize;
+	uint32_t flags;
+};
+
+struct CaptureController
+{
+	uint32_t index;
+	float value;
+};
+
+const char* const captureUris[] =
+{
+	LV2_ATOM__Float, LV2_ATOM__Int, LV2_ATOM__Long, LV2_ATOM__Double, LV2_ATOM__Bool, LV2_ATOM__URID,
+	LV2_ATOM__Object, LV2_ATOM__Blank, LV2_ATOM__Vector, LV2_ATOM__String, LV2_ATOM__Sequence,
+	LV2_MIDI__MidiEvent,
+	LV2_TIME__Position, LV2_TIME__barBeat, LV2_TIME__bar, LV2_TIME__beatsPerMinute,
+	LV2_TIME__beatsPerBar, LV2_TIME__beatUnit, LV2_TIME__speed,
+	LV2_PATCH__Set, LV2_PATCH__property, LV2_PATCH__value,
+	BSHAPR_URI "#UIon", BSHAPR_URI "#UIoff",
+	BSHAPR_URI "#NOTIFYshapeEvent", BSHAPR_URI "#NOTIFYshapeNr", BSHAPR_URI "#NOTIFYshapeData",
+	BSHAPR_URI "#NOTIFYruntimeEvent", BSHAPR_URI "#NOTIFYruntimeThreshold"
+};
+
+// Single producer, single consumer lock-free byte queue. The producer
+// write()s a record in parts and publishes it with commit ().
+class CaptureQueue
+{
+public:
+	CaptureQueue (const size_t size) : buffer (new uint8_t[size]), size (size), readPos (0), writePos (0), pendingPos (0) {}
+	~CaptureQueue () {delete[] buffer;}
+	CaptureQueue (const CaptureQueue& that) = delete;
+	CaptureQueue& operator= (const CaptureQueue& that) = delete;
+
+	size_t getWriteSpace () const {return size - (pendingPos - readPos.load (std::memory_order_acquire));}
+
+	void write (const void* data, const size_t n)
+	{
+		const size_t start = pendingPos % size;
+		const size_t n1 = (start + n > size ? size - start : n);
+		memcpy (buffer + start, data, n1);
+		memcpy (buffer, (const uint8_t*) data + n1, n - n1);
+		pendingPos += n;
+	}
+
+	void commit () {writePos.store (pendingPos, std::memory_order_release);}
+
+	size_t read (void* data, const size_t max)
+	{
+		const size_t rPos = readPos.load (std::memory_order_relaxed);
+		const size_t available = writePos.load (std::memory_order_acquire) - rPos;
+		const size_t n = (available < max ? available : max);
+		const size_t start = rPos % size;
+		const size_t n1 = (start + n > size ? size - start : n);
+		memcpy (data, buffer + start, n1);
+		memcpy ((uint8_t*) data + n1, buffer, n - n1);
+		readPos.store (rPos + n, std::memory_order_release);
+		return n;
+	}
+
+protected:
+	uint8_t* buffer;
+	size_t size;
+	std::atomic<size_t> readPos;
+	std::atomic<size_t> writePos;
+	size_t pendingPos;
+};
+
+// Records the control input (controller port values, control port atom
+// sequence, block size) of each run (). captureBlock () is real-time safe
+// and drops blocks if the queue is full. A writer thread stores the queue
+// content to the capture file.
+class Capture
+{
+public:
+	Capture (const std::string& filename, const double rate, LV2_URID_Map* map) :
+		queue (CAPTUREQUEUESIZE), file (fopen (filename.c_str (), "wb")), thread (),
+		running (true), lastControllers {0}, firstBlock (true), gap (false)
+	{
+		if (!file) throw std::runtime_error ("Can't open " + filename);
+
+		const uint32_t nrControllers = NR_CONTROLLERS;
+		const uint32_t nrUris = sizeof (captureUris) / sizeof (captureUris[0]) + NR_CONTROLLERS;
+		fwrite (CAPTURE_MAGIC, sizeof (CAPTURE_MAGIC), 1, file);
+		fwrite (&rate, sizeof (rate), 1, file);
+		fwrite (&nrControllers, sizeof (nrControllers), 1, file);
+		fwrite (&nrUris, sizeof (nrUris), 1, file);
+		for (const char* uri : captureUris) writeUri (map, uri);
+		for (int i = 0; i < NR_CONTROLLERS; ++i) writeUri (map, getControllerUri (i).c_str ());
+
+		thread = std::thread (&Capture::writerThread, this);
+	}
+
+	~Capture ()
+	{
+		running.store (false);
+		if (thread.joinable ()) thread.join ();
+		fclose (file);
+	}
+
+	Capture (const Capture& that) = delete;
+	Capture& operator= (const Capture& that) = delete;
+
+	void captureBlock (const uint32_t n, float* const* controllers, const LV2_Atom_Sequence* sequence)
+	{
+		CaptureBlockHeader header {n, 0, (uint32_t) (sizeof (LV2_Atom) + sequence->atom.size), (gap ? CAPTURE_GAP : 0u)};
+		for (int i = 0; i < NR_CONTROLLERS; ++i)
+		{
+			if (firstBlock || (*controllers[i] != lastControllers[i])) ++header.nrControllers;
+		}
+
+		const size_t size = sizeof (header) + header.nrControllers * sizeof (CaptureController) + header.sequenceSize;
+		if (size > queue.getWriteSpace ())
+		{
+			gap = true;
+			return;
+		}
+
+		queue.write (&header, sizeof (header));
+		for (int i = 0; i < NR_CONTROLLERS; ++i)
+		{
+			if (firstBlock || (*controllers[i] != lastControllers[i]))
+			{
+				const CaptureController c {uint32_t (i), *controllers[i]};
+				queue.write (&c, sizeof (c));
+				lastControllers[i] = *controllers[i];
+			}
+		}
+		queue.write (sequence, header.sequenceSize);
+		queue.commit ();
+
+		firstBlock = false;
+		gap = false;
+	}
+
+protected:
+	void writeUri (LV2_URID_Map* map, const char* uri)
+	{
+		const uint32_t urid = map->map (map->handle, uri);
+		const uint32_t length = strlen (uri);
+		fwrite (&urid, sizeof (urid), 1, file);
+		fwrite (&length, sizeof (length), 1, file);
+		fwrite (uri, length, 1, file);
+	}
+
+	void writerThread ()
+	{
+		uint8_t data[CAPTUREWRITESIZE];
+		while (true)
+		{
+			const bool stop = !running.load ();
+			const size_t n = queue.read (data, CAPTUREWRITESIZE);
+			if (n) fwrite (data, 1, n, file);
+			else if (stop) break;
+			else std::this_thread::sleep_for (std::chrono::milliseconds (CAPTUREWRITEINTERVAL));
+		}
+		fflush (file);
+	}
+
+	CaptureQueue queue;
+	FILE* file;
+	std::thread thread;
+	std::atomic<bool> running;
+	float lastControllers[NR_CONTROLLERS];
+	bool firstBlock;
+	bool gap;
+};
+
+#endif /* CAPTURE_HPP_ */
@@ -0,0 +1,75 @@
+/* B.Shapr
+ * Beat / envelope shaper LV2 plugin
+ *
+ * Copyright (C) 2019 by Sven Jähnichen
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#ifndef CYCLECOUNTER_HPP_
+#define CYCLECOUNTER_HPP_
+
+#include <cstdint>
+#include <chrono>
+#if defined (__x86_64__) || defined (__i386__)
+#include <x86intrin.h>
+#endif
+
+#define CYCLECALIBRATIONTIME 0.1
+
+// Cheap time stamp: TSC on x86, otherwise nanoseconds of the steady clock
+inline uint64_t readCycles ()
+{
+#if defined (__x86_64__) || defined (__i386__)
+	return __rdtsc ();
+#else
+	return std::chrono::duration_cast<std::chrono::nanoseconds> (std::chrono::steady_clock::now ().time_since_epoch ()).count ();
+#endif
+}
+
+// Converts cycles to seconds. Calibrates the cycle counter against the
+// steady clock on each update () call (once per run) after
+// CYCLECALIBRATIONTIME, with an increasing accuracy over time.
+class CycleCounter
+{
+public:
+	CycleCounter () : startCycles (0), startTime (), cyclesPerSecond (0.0) {}
+
+	void update ()
+	{
+		const uint64_t cycles = readCycles ();
+		const std::chrono::steady_clock::time_point time = std::chrono::steady_clock::now ();
+
+		if (startCycles == 0)
+		{
+			startCycles = cycles;
+			startTime = time;
+			return;
+		}
+
+		const double seconds = std::chrono::duration<double> (time - startTime).count ();
+		if ((seconds >= CYCLECALIBRATIONTIME) && (cycles > startCycles)) cyclesPerSecond = (cycles - startCycles) / seconds;
+	}
+
+	bool isCalibrated () const {return (cyclesPerSecond > 0.0);}
+	double toSeconds (const uint64_t cycles) const {return (isCalibrated () ? cycles / cyclesPerSecond : 0.0);}
+
+protected:
+	uint64_t startCycles;
+	std::chrono::steady_clock::time_point startTime;
+	double cyclesPerSecond;
+};
+
+#endif /* CYCLECOUNTER_HPP_ */
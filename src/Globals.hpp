@@ -24,6 +24,8 @@
 #define MIN_OPT_VAL -20000
 #define MAX_OPT_VAL 20000
 
+#include <string>
+#include "definitions.hpp"
 #include "Method.hpp"
 #include "ports.h"
 
@@ -58,6 +60,38 @@ const Limit shapeControllerLimits [SH_SIZE] =
 	{MIN_OPT_VAL, MAX_OPT_VAL, 0}
 };
 
+// Port symbols (as in BShapr.ttl) of the global controllers and of the
+// shape controllers (without "sh<n>_" prefix)
+const std::string globalControllerSymbols[SHAPERS] =
+{
+	"bypass", "dry_wet", "midi_control", "midi_keys", "midi_thru", "base", "base_value", "active_shape"
+};
+
+const std::string shapeControllerSymbols[SH_SIZE] =
+{
+	"input", "input_amp", "target", "dry_wet", "output", "output_amp", "smoothing",
+	"opt1", "opt2", "opt3", "opt4", "opt5", "opt6", "opt7", "opt8"
+};
+
+inline std::string getControllerSymbol (const int nr)
+{
+	if (nr < SHAPERS) return globalControllerSymbols[nr];
+	return "sh" + std::to_string ((nr - SHAPERS) / SH_SIZE + 1) + "_" + shapeControllerSymbols[(nr - SHAPERS) % SH_SIZE];
+}
+
+// Parameter URI (for patch:Set) of controller nr
+inline std::string getControllerUri (const int nr) {return BSHAPR_URI "#" + getControllerSymbol (nr);}
+
+// Controllers which can also be set sample accurately by patch:Set (declared
+// as patch:writable in BShapr.ttl): the mix and amplification controllers
+inline bool isParameterController (const int nr)
+{
+	if ((nr < 0) || (nr >= NR_CONTROLLERS)) return false;
+	if (nr < SHAPERS) return (nr == DRY_WET);
+	const int shapeControllerNr = (nr - SHAPERS) % SH_SIZE;
+	return ((shapeControllerNr == SH_INPUT_AMP) || (shapeControllerNr == SH_DRY_WET) || (shapeControllerNr == SH_OUTPUT_AMP));
+}
+
 enum Distortions
 {
 	HARDCLIP	= 0,
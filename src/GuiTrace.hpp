@@ -0,0 +1,98 @@
+/* B.Shapr
+ * Beat / envelope shaper LV2 plugin
+ *
+ * Copyright (C) 2019 by Sven Jähnichen
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#ifndef GUITRACE_HPP_
+#define GUITRACE_HPP_
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <chrono>
+
+#define GUITRACE_ENV "BSHAPR_GUI_TRACE"
+
+// Timing spans of the GUI startup. Enabled if the environment variable
+// BSHAPR_GUI_TRACE is set to "stderr" or to a file name (appended). The
+// spans are collected and written once the first frame is shown, one line
+// per span:
+//	<name> <start_us> <duration_us>
+// with the start relative to the GUI instantiation.
+class GuiTrace
+{
+public:
+	GuiTrace () :
+		enabled (false), dumped (false), filename (),
+		created (std::chrono::steady_clock::now ()), start (created), spans ()
+	{
+		const char* env = getenv (GUITRACE_ENV);
+		if (env && env[0])
+		{
+			enabled = true;
+			filename = env;
+		}
+	}
+
+	bool isEnabled () const {return enabled && (!dumped);}
+
+	static std::chrono::steady_clock::time_point now () {return std::chrono::steady_clock::now ();}
+
+	std::chrono::steady_clock::time_point getCreated () const {return created;}
+
+	std::chrono::steady_clock::time_point getStart () const {return start;}
+
+	void setStart (const std::chrono::steady_clock::time_point& t) {start = t;}
+
+	void add (const std::string& name, const std::chrono::steady_clock::time_point& t0, const std::chrono::steady_clock::time_point& t1)
+	{
+		if (isEnabled ()) spans.push_back ({name, t0, t1});
+	}
+
+	void dump ()
+	{
+		if (!isEnabled ()) return;
+		dumped = true;
+
+		FILE* file = (filename == "stderr" ? stderr : fopen (filename.c_str (), "a"));
+		if (!file) return;
+		for (const Span& s : spans) fprintf (file, "%s %.0f %.0f\n", s.name.c_str (), microseconds (s.t0 - start), microseconds (s.t1 - s.t0));
+		if (file != stderr) fclose (file);
+		spans.clear ();
+	}
+
+protected:
+	struct Span
+	{
+		std::string name;
+		std::chrono::steady_clock::time_point t0;
+		std::chrono::steady_clock::time_point t1;
+	};
+
+	static double microseconds (const std::chrono::steady_clock::duration& d) {return std::chrono::duration<double, std::micro> (d).count ();}
+
+	bool enabled;
+	bool dumped;
+	std::string filename;
+	std::chrono::steady_clock::time_point created;
+	std::chrono::steady_clock::time_point start;
+	std::vector<Span> spans;
+};
+
+#endif /* GUITRACE_HPP_ */
@@ -25,24 +25,37 @@ MonitorWidget::MonitorWidget () : MonitorWidget (0, 0, 0, 0, "monitor") {}
 
 MonitorWidget::MonitorWidget (const double x, const double y, const double width, const double height, const std::string& name) :
         Widget (x, y, width, height, name),
-        fgColors (BColors::whites), zoom (0.25), pat (nullptr)
+        channels (), zoom (0.25)
 {
-        clear ();
         setClickable (false);
-        makePattern ();
 }
 
 MonitorWidget::~MonitorWidget ()
 {
-        if (pat) cairo_pattern_destroy (pat);
+        for (Channel& c : channels)
+        {
+                if (c.pat) cairo_pattern_destroy (c.pat);
+        }
+}
+
+int MonitorWidget::addChannel (const double y, const double height, const std::string& colorStyle)
+{
+        channels.push_back (Channel {y, height, colorStyle, {}, BColors::whites, nullptr});
+        channels.back().data.fill ({0.0f, 0.0f});
+        makePatterns ();
+        return channels.size () - 1;
 }
 
-void MonitorWidget::clear () {data.fill ({0.0f, 0.0f});}
+void MonitorWidget::clear ()
+{
+        for (Channel& c : channels) c.data.fill ({0.0f, 0.0f});
+}
 
-void MonitorWidget::addData (const unsigned int pos, const Range range)
+void MonitorWidget::addData (const int channel, const unsigned int pos, const Range range)
 {
+        if ((channel < 0) || (channel >= int (channels.size ()))) return;
         unsigned int nr = LIMIT (pos, 0, MONITORBUFFERSIZE - 1);
-        data[nr] = range;
+        channels[channel].data[nr] = range;
 }
 
 void MonitorWidget::setZoom (const double factor)
@@ -61,6 +74,8 @@ void MonitorWidget::redrawRange (const unsigned int start, const unsigned int en
         double x1 = getWidth() * s / (MONITORBUFFERSIZE - 1);
         double w = getWidth() * (e - s) / (MONITORBUFFERSIZE - 1);
 
+        // All channels share the surface: draw the new columns of each
+        // channel and expose them once
         drawData (s, e);
         if (isVisible ()) postRedisplay (BUtilities::RectArea (xabs + x1, yabs, w, getHeight()));
 }
@@ -71,35 +86,43 @@ void MonitorWidget::applyTheme (BStyles::Theme& theme, const std::string& name)
 {
 	Widget::applyTheme (theme, name);
 
-	void* fgPtr = theme.getStyle(name, BWIDGETS_KEYWORD_FGCOLORS);
-	if (fgPtr)
+	bool changed = false;
+	for (Channel& c : channels)
 	{
-		fgColors = *((BColors::ColorSet*) fgPtr);
-		update ();
+		void* fgPtr = theme.getStyle(c.colorStyle, BWIDGETS_KEYWORD_FGCOLORS);
+		if (fgPtr)
+		{
+			c.fgColors = *((BColors::ColorSet*) fgPtr);
+			changed = true;
+		}
 	}
+
+	if (changed) update ();
 }
 
 void MonitorWidget::update ()
 {
-        makePattern ();
+        makePatterns ();
         Widget::update ();
 }
 
-void MonitorWidget::makePattern ()
+void MonitorWidget::makePatterns ()
 {
-        if (pat) cairo_pattern_destroy (pat);
-        pat = cairo_pattern_create_linear (0, 0, 0, getHeight());
-        BColors::Color col = *fgColors.getColor (getState ());
-        cairo_pattern_add_color_stop_rgba (pat, 1, col.getRed (), col.getGreen (), col.getBlue (), 0.6 * col.getAlpha ());
-        cairo_pattern_add_color_stop_rgba (pat, 0.5, col.getRed (), col.getGreen (), col.getBlue (), 0.1 * col.getAlpha ());
-        cairo_pattern_add_color_stop_rgba (pat, 0, col.getRed (), col.getGreen (), col.getBlue (), 0.6 * col.getAlpha ());
+        for (Channel& c : channels)
+        {
+                if (c.pat) cairo_pattern_destroy (c.pat);
+                c.pat = cairo_pattern_create_linear (0, c.y * getHeight(), 0, (c.y + c.height) * getHeight());
+                BColors::Color col = *c.fgColors.getColor (getState ());
+                cairo_pattern_add_color_stop_rgba (c.pat, 1, col.getRed (), col.getGreen (), col.getBlue (), 0.6 * col.getAlpha ());
+                cairo_pattern_add_color_stop_rgba (c.pat, 0.5, col.getRed (), col.getGreen (), col.getBlue (), 0.1 * col.getAlpha ());
+                cairo_pattern_add_color_stop_rgba (c.pat, 0, col.getRed (), col.getGreen (), col.getBlue (), 0.6 * col.getAlpha ());
+        }
 }
 
 void MonitorWidget::drawData (const unsigned int start, const unsigned int end)
 {
         if ((!widgetSurface_) || (cairo_surface_status (widgetSurface_) != CAIRO_STATUS_SUCCESS)) return;
 
-        BColors::Color col = *fgColors.getColor (getState ());
 	cairo_t* cr = cairo_create (widgetSurface_);
 
 	if (cairo_status (cr) == CAIRO_STATUS_SUCCESS)
@@ -114,39 +137,41 @@ void MonitorWidget::drawData (const unsigned int start, const unsigned int end)
 		cairo_set_source_rgba (cr, 0.0, 0.0, 0.0, 0.0);
 		cairo_set_operator (cr, CAIRO_OPERATOR_SOURCE);
 		cairo_paint (cr);
+		cairo_set_operator (cr, CAIRO_OPERATOR_OVER);
 
-                cairo_set_line_width (cr, 2);
-                cairo_move_to (cr, getWidth() * double (start) / (MONITORBUFFERSIZE - 1), getHeight() * (0.5  - (0.48 * LIMIT ((data[start].max / zoom), -1, 1))));
-                for (int i = start + 1; i <= int (end); ++i)
+                for (Channel& c : channels)
                 {
-                        cairo_line_to (cr, getWidth() * double (i) / (MONITORBUFFERSIZE - 1), getHeight() * (0.5  - (0.48 * LIMIT ((data[i].max / zoom), -1, 1))));
+                        drawChannel (cr, c, start, end, true);
+                        drawChannel (cr, c, start, end, false);
                 }
-                cairo_set_source_rgba (cr, CAIRO_RGBA (col));
-                cairo_stroke_preserve (cr);
-                cairo_set_line_width (cr, 0);
-                cairo_line_to (cr, getWidth() * double (end) / (MONITORBUFFERSIZE - 1), getHeight() * 0.5);
-                cairo_line_to (cr, getWidth() * double (start) / (MONITORBUFFERSIZE - 1), getHeight() * 0.5);
-                cairo_close_path (cr);
-                cairo_set_source (cr, pat);
-                cairo_fill (cr);
-
-                cairo_set_line_width (cr, 2);
-                cairo_move_to (cr, getWidth() * double (start) / (MONITORBUFFERSIZE - 1), getHeight() * (0.5  - (0.48 * LIMIT ((data[start].min / zoom), -1, 1))));
-                for (int i = start + 1; i <= int (end); ++i)
-                {
-                        cairo_line_to (cr, getWidth() * double (i) / (MONITORBUFFERSIZE - 1), getHeight() * (0.5  - (0.48 * LIMIT ((data[i].min / zoom), -1, 1))));
-                }
-                cairo_set_source_rgba (cr, CAIRO_RGBA (col));
-                cairo_stroke_preserve (cr);
-                cairo_set_line_width (cr, 0);
-                cairo_line_to (cr, getWidth() * double (end) / (MONITORBUFFERSIZE - 1), getHeight() * 0.5);
-                cairo_line_to (cr, getWidth() * double (start) / (MONITORBUFFERSIZE - 1), getHeight() * 0.5);
-                cairo_close_path (cr);
-                cairo_set_source (cr, pat);
-                cairo_fill (cr);
+        }
+
+        cairo_destroy (cr);
+}
 
-                cairo_destroy (cr);
+void MonitorWidget::drawChannel (cairo_t* cr, Channel& channel, const unsigned int start, const unsigned int end, const bool maxima)
+{
+        const double y0 = channel.y * getHeight();
+        const double h = channel.height * getHeight();
+        BColors::Color col = *channel.fgColors.getColor (getState ());
+
+        cairo_set_line_width (cr, 2);
+        for (int i = start; i <= int (end); ++i)
+        {
+                const double value = (maxima ? channel.data[i].max : channel.data[i].min);
+                const double x = getWidth() * double (i) / (MONITORBUFFERSIZE - 1);
+                const double y = y0 + h * (0.5  - (0.48 * LIMIT ((value / zoom), -1, 1)));
+                if (i == int (start)) cairo_move_to (cr, x, y);
+                else cairo_line_to (cr, x, y);
         }
+        cairo_set_source_rgba (cr, CAIRO_RGBA (col));
+        cairo_stroke_preserve (cr);
+        cairo_set_line_width (cr, 0);
+        cairo_line_to (cr, getWidth() * double (end) / (MONITORBUFFERSIZE - 1), y0 + h * 0.5);
+        cairo_line_to (cr, getWidth() * double (start) / (MONITORBUFFERSIZE - 1), y0 + h * 0.5);
+        cairo_close_path (cr);
+        cairo_set_source (cr, channel.pat);
+        cairo_fill (cr);
 }
 
 void MonitorWidget::draw (const BUtilities::RectArea& area)
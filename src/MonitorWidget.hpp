@@ -24,7 +24,13 @@
 #include "BWidgets/Widget.hpp"
 #include "definitions.hpp"
 #include "Range.hpp"
+#include <array>
+#include <vector>
+#include <string>
 
+// Level monitor for multiple channels drawn into one shared surface. Each
+// channel occupies a horizontal band of the widget and takes its colors from
+// its own style. Only the changed columns are redrawn and exposed.
 class MonitorWidget : public BWidgets::Widget
 {
 public:
@@ -32,8 +38,9 @@ public:
         MonitorWidget (const double x, const double y, const double width, const double height, const std::string& name);
         ~MonitorWidget ();
 
+        int addChannel (const double y, const double height, const std::string& colorStyle);
         void clear ();
-        void addData (const unsigned int pos, const Range range);
+        void addData (const int channel, const unsigned int pos, const Range range);
         void setZoom (const double factor);
         double getZoom () const;
         void redrawRange (const unsigned int start, const unsigned int end);
@@ -42,14 +49,23 @@ public:
         virtual void update () override;
 
 protected:
-        void makePattern ();
+        struct Channel
+        {
+                double y;               // Band position and height relative to the widget height
+                double height;
+                std::string colorStyle;
+                std::array<Range, MONITORBUFFERSIZE> data;
+                BColors::ColorSet fgColors;
+                cairo_pattern_t* pat;
+        };
+
+        void makePatterns ();
         void drawData (const unsigned int start, const unsigned int end);
+        void drawChannel (cairo_t* cr, Channel& channel, const unsigned int start, const unsigned int end, const bool maxima);
         virtual void draw (const BUtilities::RectArea& area) override;
 
-        std::array<Range, MONITORBUFFERSIZE> data;
-        BColors::ColorSet fgColors;
+        std::vector<Channel> channels;
         double zoom;
-        cairo_pattern_t* pat;
 };
 
 #endif /* MONITORWIDGET_HPP_ */
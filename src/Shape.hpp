@@ -65,8 +65,16 @@ public:
 	bool changeNode (const size_t pos, const Node& newnode);
 	bool deleteNode (const size_t pos);
 
+	// Edit transaction: Node changes, insertions, and deletions between
+	// beginEdit () and commitEdit () are only stored. commitEdit () validates
+	// the changed nodes and their neighbors and renders each segment next to
+	// a changed node once.
+	void beginEdit ();
+	bool commitEdit ();
+
 	double getMapRawValue (const double x) const;
 	double getMapValue (const double x) const;
+	void getMapValues (const double x, const double dx, float* values, const size_t n) const;
 	double* getMap ();
 
 protected:
@@ -77,18 +85,21 @@ protected:
 	virtual void drawLineOnMap (const BUtilities::Point p1, const BUtilities::Point p2);
 	BUtilities::Point getPointPerc (const BUtilities::Point p1, const BUtilities::Point p2, const double perc) const;
 	virtual void renderBezier (const Node& n1, const Node& n2);
+	void markEdited (const size_t nr);
 
 	StaticArrayList<Node, sz> nodes_;
 	double map_[MAPRES];
 	double factor_;
 	double offset_;
+	int editDepth_;
+	bool edited_[sz];	// Changed nodes within an edit transaction
 
 };
 
-template<size_t sz> Shape<sz>::Shape () : nodes_ (), map_ {0.0}, factor_ (1.0), offset_ (0.0) {}
+template<size_t sz> Shape<sz>::Shape () : nodes_ (), map_ {0.0}, factor_ (1.0), offset_ (0.0), editDepth_ (0), edited_ {false} {}
 
 template<size_t sz> Shape<sz>::Shape (const StaticArrayList<Node, sz> nodes, double transformFactor, double transformOffset) :
-nodes_ (nodes), map_ {0.0}, factor_ (transformFactor), offset_ (transformFactor) {}
+nodes_ (nodes), map_ {0.0}, factor_ (transformFactor), offset_ (transformFactor), editDepth_ (0), edited_ {false} {}
 
 template<size_t sz> Shape<sz>::~Shape () {}
 
@@ -177,6 +188,14 @@ template<size_t sz> bool Shape<sz>::insertRawNode (const size_t pos, const Node&
 		nodes_.push_back (node);
 	}
 
+	if (editDepth_ > 0)
+	{
+		// Shift the stored changes
+		for (size_t i = nodes_.size - 1; i > p; --i) edited_[i] = edited_[i - 1];
+		markEdited (p);
+		return true;
+	}
+
 	// Validate node and its neighbors
 	if (!validateNode (p)) return false;
 	if ((p > 0) && (!validateNode (p - 1))) return false;
@@ -225,6 +244,12 @@ template<size_t sz> bool Shape<sz>::changeRawNode (const size_t pos, const Node&
 	if (pos >= nodes_.size) return false;
 	nodes_[pos] = node;
 
+	if (editDepth_ > 0)
+	{
+		markEdited (pos);
+		return true;
+	}
+
 	// Validate node and its neighbors
 	if (!validateNode (pos)) return false;
 	if ((pos > 0) && (!validateNode (pos - 1))) return false;
@@ -248,6 +273,15 @@ template<size_t sz> bool Shape<sz>::deleteNode (const size_t pos)
 
 	nodes_.erase (nodes_.begin() + pos);
 
+	if (editDepth_ > 0)
+	{
+		// Shift the stored changes
+		for (size_t i = pos; i < nodes_.size; ++i) edited_[i] = edited_[i + 1];
+		edited_[nodes_.size] = false;
+		markEdited (pos - 1);
+		return true;
+	}
+
 	// Validate neighbor nodes
 	if (!validateNode (pos - 1)) return false;
 	if (!validateNode (pos)) return false;
@@ -257,19 +291,72 @@ template<size_t sz> bool Shape<sz>::deleteNode (const size_t pos)
 	return true;
 }
 
+template<size_t sz> void Shape<sz>::beginEdit ()
+{
+	if (editDepth_ == 0)
+	{
+		for (size_t i = 0; i < sz; ++i) edited_[i] = false;
+	}
+	++editDepth_;
+}
+
+template<size_t sz> bool Shape<sz>::commitEdit ()
+{
+	if (editDepth_ <= 0) return true;
+	--editDepth_;
+	if (editDepth_ > 0) return true;
+
+	// Collect the nodes to validate (changed nodes and their neighbors) and
+	// the segments to render (from two before to one after a changed node)
+	bool validate[sz] = {false};
+	bool render[sz] = {false};
+	bool changed = false;
+	for (size_t i = 0; i < nodes_.size; ++i)
+	{
+		if (!edited_[i]) continue;
+		edited_[i] = false;
+		changed = true;
+		for (size_t j = (i >= 1 ? i - 1 : 0); (j <= i + 1) && (j < nodes_.size); ++j) validate[j] = true;
+		for (size_t j = (i >= 2 ? i - 2 : 0); (j <= i + 1) && (j + 1 < nodes_.size); ++j) render[j] = true;
+	}
+	if (!changed) return true;
+
+	for (size_t i = 0; i < nodes_.size; ++i)
+	{
+		if (validate[i] && (!validateNode (i))) return false;
+	}
+
+	// Update map: each segment once
+	for (size_t i = 0; i + 1 < nodes_.size; ++i)
+	{
+		if (render[i]) renderBezier (nodes_[i], nodes_[i + 1]);
+	}
+	return true;
+}
+
+template<size_t sz> void Shape<sz>::markEdited (const size_t nr)
+{
+	if (nr < nodes_.size) edited_[nr] = true;
+}
+
 template<size_t sz> bool Shape<sz>::validateNode (const size_t nr)
 {
 	// Exception: Invalid parameters
 	if (nr >= nodes_.size)
 	{
+		// No console output from within the DSP (real-time) thread
+#ifndef BSHAPR_HPP_
 		fprintf (stderr, "BShapr.lv2: Node validation called with invalid parameters (node: %li).\n", nr);
+#endif
 		return false;
 	}
 
 	// Exception: Invalid node order
 	if ((nodes_.size >= 3) && (nr > 1) && (nr < nodes_.size - 1) && (nodes_[nr-1].point.x > nodes_[nr+1].point.x))
 	{
+#ifndef BSHAPR_HPP_
 		fprintf (stderr, "BShapr.lv2: Corrupt node data at node %li (%f, %f). Reset shape.\n", nr, nodes_[nr].point.x, nodes_[nr].point.y);
+#endif
 		setDefaultShape ();
 		return false;
 	}
@@ -533,6 +620,34 @@ template<size_t shapesize> double Shape<shapesize>::getMapValue (const double x)
 	return retransform (getMapRawValue (x));
 }
 
+template<size_t shapesize> void Shape<shapesize>::getMapValues (const double x, const double dx, float* values, const size_t n) const
+{
+	// Fall back to single value calculation if the increment exceeds a whole loop
+	if (fabs (dx) >= 1.0)
+	{
+		for (size_t i = 0; i < n; ++i) values[i] = getMapValue (x + i * dx);
+		return;
+	}
+
+	// Phase accumulator in map units, wrapped into [0, MAPRES)
+	double mapx = (x - floor (x)) * MAPRES;
+	const double mapdx = dx * MAPRES;
+	if (mapx >= MAPRES) mapx -= MAPRES;
+
+	for (size_t i = 0; i < n; ++i)
+	{
+		const int i0 = int (mapx);
+		const int i1 = (i0 + 1 < MAPRES ? i0 + 1 : 0);
+		const double xmod = mapx - i0;
+		values[i] = factor_ * ((1 - xmod) * map_[i0] + xmod * map_[i1]) + offset_;
+
+		// A tiny negative mapx + MAPRES may round up to MAPRES: wrap again
+		mapx += mapdx;
+		if (mapx < 0) mapx += MAPRES;
+		if (mapx >= MAPRES) mapx -= MAPRES;
+	}
+}
+
 template<size_t sz> double* Shape<sz>::getMap () {return &map_[0];}
 
 /*
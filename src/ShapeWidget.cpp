@@ -179,6 +179,7 @@ void ShapeWidget::pasteSelection (const std::vector<Node>& newNodes)
 {
 	selection.clear ();
 
+	beginEdit ();
 	for (Node const& n : newNodes)
 	{
 		Node node = n;
@@ -226,14 +227,16 @@ void ShapeWidget::pasteSelection (const std::vector<Node>& newNodes)
 			}
 		}
 	}
+	commitEdit ();
 
-	undoSnapshots.push (*this);
+	pushToSnapshots ();
 }
 
 void ShapeWidget::deleteSelection ()
 {
 	grabbedNode = -1;
 	bool selected = false;
+	beginEdit ();
 	for (int i = nodes_.size; i >= 0; --i)
 	{
 		if (selection[i])
@@ -242,6 +245,7 @@ void ShapeWidget::deleteSelection ()
 			deleteNode (i);
 		}
 	}
+	commitEdit ();
 
 	if (selected)
 	{
@@ -249,7 +253,7 @@ void ShapeWidget::deleteSelection ()
 		update ();
 	}
 
-	undoSnapshots.push (*this);
+	pushToSnapshots ();
 }
 
 void ShapeWidget::unselect ()
@@ -262,34 +266,41 @@ void ShapeWidget::reset ()
 {
 	unselect ();
 	Shape::setDefaultShape ();
-	undoSnapshots.push (*this);
+	pushToSnapshots ();
 }
 
 void ShapeWidget::undo ()
 {
 	unselect ();
-	clearShape ();
-	this->Shape::operator= (undoSnapshots.undo ());
-	validateShape ();
+	restoreSnapshot (undoSnapshots.undo ());
 }
 
 void ShapeWidget::redo ()
 {
 	unselect ();
-	clearShape ();
-	this->Shape::operator= (undoSnapshots.redo ());
-	validateShape ();
+	restoreSnapshot (undoSnapshots.redo ());
 }
 
 void ShapeWidget::pushToSnapshots ()
 {
-	undoSnapshots.push (*this);
+	// Only store the nodes, the map is rendered on restore
+	std::vector<Node> snapshot;
+	snapshot.reserve (nodes_.size);
+	for (size_t i = 0; i < nodes_.size; ++i) snapshot.push_back (nodes_[i]);
+	undoSnapshots.push (snapshot);
 }
 
 void ShapeWidget::resetSnapshots ()
 {
 	undoSnapshots.clear ();
-	undoSnapshots.push (*this);
+	pushToSnapshots ();
+}
+
+void ShapeWidget::restoreSnapshot (const std::vector<Node>& snapshot)
+{
+	clearShape ();
+	for (const Node& n : snapshot) appendRawNode (n);
+	validateShape ();
 }
 
 void ShapeWidget::setDefaultShape ()
@@ -465,14 +476,14 @@ void ShapeWidget::onButtonReleased (BEvents::PointerEvent* event)
 				default: break;
 			}
 
-			undoSnapshots.push (*this);
+			pushToSnapshots ();
 		}
 
 		else if (clickMode == DRAG_SELECTION)
 		{
 			selection.setOrigin ({0, 0});
 			selection.setExtend ({0, 0});
-			undoSnapshots.push (*this);
+			pushToSnapshots ();
 			update ();
 		}
 	}
@@ -566,7 +577,8 @@ void ShapeWidget::onPointerDragged (BEvents::PointerEvent* event)
 					}
 				}
 
-				// Move selected points
+				// Move selected points, validate and render once
+				beginEdit ();
 				for (size_t i = 0; i < nodes_.size; ++i)
 				{
 					if (selection[i])
@@ -595,6 +607,7 @@ void ShapeWidget::onPointerDragged (BEvents::PointerEvent* event)
 						}
 					}
 				}
+				commitEdit ();
 			}
 		}
 
@@ -861,9 +874,28 @@ void ShapeWidget::draw (const BUtilities::RectArea& area)
 			}
 		}
 
-		// Draw curve
-		cairo_move_to (cr, x0, y0 + h - h * (retransform (map_[0]) - ymin) / (ymax - ymin));
-		for (int i = 1; i < MAPRES; ++i) cairo_line_to (cr, x0 + w * i / MAPRES, y0 + h - h * (retransform (map_[i]) - ymin) / (ymax - ymin));
+		// Draw curve directly from the nodes as Bezier segments. The map
+		// (rendered from the same segments) is only used for the DSP.
+		if (nodes_.size >= 2)
+		{
+			Node n1 = getNode (0);
+			cairo_move_to (cr, x0 + n1.point.x * w, y0 + h - h * (n1.point.y - ymin) / (ymax - ymin));
+			for (unsigned int i = 1; i < nodes_.size; ++i)
+			{
+				Node n2 = getNode (i);
+				BUtilities::Point c1 = n1.point + n1.handle2;
+				BUtilities::Point c2 = n2.point + n2.handle1;
+				cairo_curve_to
+				(
+					cr,
+					x0 + c1.x * w, y0 + h - h * (c1.y - ymin) / (ymax - ymin),
+					x0 + c2.x * w, y0 + h - h * (c2.y - ymin) / (ymax - ymin),
+					x0 + n2.point.x * w, y0 + h - h * (n2.point.y - ymin) / (ymax - ymin)
+				);
+				n1 = n2;
+			}
+		}
+		else cairo_move_to (cr, x0, y0 + h - h * (retransform (map_[0]) - ymin) / (ymax - ymin));
 		cairo_set_line_width (cr, 2);
 		cairo_set_source_rgba (cr, CAIRO_RGBA (lineColor));
 		cairo_stroke_preserve (cr);
@@ -118,7 +118,8 @@ protected:
 	double snapX (const double x);
 	double snapY (const double y);
 
-	Snapshots<Shape<MAXNODES>, MAXUNDO> undoSnapshots;
+	Snapshots<std::vector<Node>, MAXUNDO> undoSnapshots;
+	void restoreSnapshot (const std::vector<Node>& snapshot);
 
 	virtual void drawLineOnMap (BUtilities::Point p1, BUtilities::Point p2) override;
 	virtual void draw (const BUtilities::RectArea& area) override;
@@ -0,0 +1,36 @@
+/* B.Shapr
+ * Beat / envelope shaper LV2 plugin
+ *
+ * Copyright (C) 2019 by Sven Jähnichen
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#ifndef TARGETCLONES_HPP_
+#define TARGETCLONES_HPP_
+
+// Hot DSP kernels marked with TARGET_CLONES are compiled in several ISA
+// variants (AVX-512, AVX2, baseline). The best variant for the running CPU
+// is selected once via CPUID when the plugin library is loaded (GNU ifunc).
+// Only mark leaf loops with a measured gain in bshapr-bench: Each clone adds
+// code size and an indirect call, and AVX code called from baseline code may
+// even be slower. Define NO_TARGET_CLONES to build the baseline variant only.
+#if defined (__GNUC__) && !defined (__clang__) && (__GNUC__ >= 6) && defined (__x86_64__) && defined (__linux__) && !defined (NO_TARGET_CLONES)
+#define TARGET_CLONES __attribute__ ((target_clones ("avx512f", "avx2", "default")))
+#else
+#define TARGET_CLONES
+#endif
+
+#endif /* TARGETCLONES_HPP_ */
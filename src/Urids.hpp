@@ -26,6 +26,7 @@
 #include <lv2/lv2plug.in/ns/ext/urid/urid.h>
 #include <lv2/lv2plug.in/ns/ext/midi/midi.h>
 #include <lv2/lv2plug.in/ns/ext/time/time.h>
+#include <lv2/lv2plug.in/ns/ext/patch/patch.h>
 #include "definitions.hpp"
 
 struct BShaprURIDs
@@ -33,6 +34,8 @@ struct BShaprURIDs
 	LV2_URID atom_Float;
 	LV2_URID atom_Int;
 	LV2_URID atom_Long;
+	LV2_URID atom_Double;
+	LV2_URID atom_URID;
 	LV2_URID atom_Object;
 	LV2_URID atom_Blank;
 	LV2_URID atom_eventTransfer;
@@ -46,6 +49,9 @@ struct BShaprURIDs
 	LV2_URID time_beatsPerBar;
 	LV2_URID time_beatUnit;
 	LV2_URID time_speed;
+	LV2_URID patch_Set;
+	LV2_URID patch_property;
+	LV2_URID patch_value;
 	LV2_URID state_shape;
 	LV2_URID ui_on;
 	LV2_URID ui_off;
@@ -61,6 +67,12 @@ struct BShaprURIDs
 	LV2_URID notify_messageEvent;
 	LV2_URID notify_message;
 	LV2_URID notify_statusEvent;
+	LV2_URID notify_cpuEvent;
+	LV2_URID notify_cpuLoad;
+	LV2_URID notify_runtimeEvent;
+	LV2_URID notify_runtimeHistogram;
+	LV2_URID notify_runtimeOverloads;
+	LV2_URID notify_runtimeThreshold;
 };
 
 void mapURIDs (LV2_URID_Map* m, BShaprURIDs* uris)
@@ -68,6 +80,8 @@ void mapURIDs (LV2_URID_Map* m, BShaprURIDs* uris)
 	uris->atom_Float = m->map(m->handle, LV2_ATOM__Float);
 	uris->atom_Int = m->map(m->handle, LV2_ATOM__Int);
 	uris->atom_Long = m->map(m->handle, LV2_ATOM__Long);
+	uris->atom_Double = m->map(m->handle, LV2_ATOM__Double);
+	uris->atom_URID = m->map(m->handle, LV2_ATOM__URID);
 	uris->atom_Object = m->map(m->handle, LV2_ATOM__Object);
 	uris->atom_Blank = m->map(m->handle, LV2_ATOM__Blank);
 	uris->atom_eventTransfer = m->map(m->handle, LV2_ATOM__eventTransfer);
@@ -81,6 +95,9 @@ void mapURIDs (LV2_URID_Map* m, BShaprURIDs* uris)
 	uris->time_beatUnit = m->map(m->handle, LV2_TIME__beatUnit);
 	uris->time_beatsPerBar = m->map(m->handle, LV2_TIME__beatsPerBar);
 	uris->time_speed = m->map(m->handle, LV2_TIME__speed);
+	uris->patch_Set = m->map(m->handle, LV2_PATCH__Set);
+	uris->patch_property = m->map(m->handle, LV2_PATCH__property);
+	uris->patch_value = m->map(m->handle, LV2_PATCH__value);
 	uris->state_shape = m->map(m->handle, BSHAPR_URI "#STATEshape");
 	uris->ui_on = m->map(m->handle, BSHAPR_URI "#UIon");
 	uris->ui_off = m->map(m->handle, BSHAPR_URI "#UIoff");
@@ -96,6 +113,12 @@ void mapURIDs (LV2_URID_Map* m, BShaprURIDs* uris)
 	uris->notify_messageEvent = m->map(m->handle, BSHAPR_URI "#NOTIFYmessageEvent");
 	uris->notify_message = m->map(m->handle, BSHAPR_URI "#NOTIFYmessage");
 	uris->notify_statusEvent = m->map(m->handle, BSHAPR_URI "#NOTIFYstatusEvent");
+	uris->notify_cpuEvent = m->map(m->handle, BSHAPR_URI "#NOTIFYcpuEvent");
+	uris->notify_cpuLoad = m->map(m->handle, BSHAPR_URI "#NOTIFYcpuLoad");
+	uris->notify_runtimeEvent = m->map(m->handle, BSHAPR_URI "#NOTIFYruntimeEvent");
+	uris->notify_runtimeHistogram = m->map(m->handle, BSHAPR_URI "#NOTIFYruntimeHistogram");
+	uris->notify_runtimeOverloads = m->map(m->handle, BSHAPR_URI "#NOTIFYruntimeOverloads");
+	uris->notify_runtimeThreshold = m->map(m->handle, BSHAPR_URI "#NOTIFYruntimeThreshold");
 }
 
 #endif /* URIDS_HPP_ */
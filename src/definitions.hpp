@@ -29,7 +29,7 @@
 #define MAXOPTIONWIDGETS 4
 #define MAXEFFECTS 16
 #define MAXMESSAGES 4
-#define MAXUNDO 20
+#define MAXUNDO 100
 #define GRIDSIZE 2.0
 
 #ifdef SUPPORTS_CV
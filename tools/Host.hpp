@@ -0,0 +1,376 @@
+/* B.Shapr
+ * Beat / envelope shaper LV2 plugin
+ *
+ * Copyright (C) 2019 by Sven Jähnichen
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#ifndef HOST_HPP_
+#define HOST_HPP_
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <map>
+#include <utility>
+#include <stdexcept>
+#include <lv2/lv2plug.in/ns/lv2core/lv2.h>
+#include <lv2/lv2plug.in/ns/ext/atom/atom.h>
+#include <lv2/lv2plug.in/ns/ext/atom/forge.h>
+#include <lv2/lv2plug.in/ns/ext/urid/urid.h>
+#include <lv2/lv2plug.in/ns/ext/midi/midi.h>
+#include <lv2/lv2plug.in/ns/ext/time/time.h>
+#include <lv2/lv2plug.in/ns/ext/state/state.h>
+#include <lv2/lv2plug.in/ns/ext/patch/patch.h>
+#include "../src/definitions.hpp"
+#include "../src/ports.h"
+#include "../src/Globals.hpp"
+
+#define HOST_ATOMBUFFERSIZE 0x10000
+
+// Port defaults as defined in BShapr.ttl
+const float globalControllerDefaults[SHAPERS] = {0, 1, 0, 4095, 0, 2, 1, 1};
+const float shapeControllerDefaults[MAXSHAPES][SH_SIZE] =
+{
+	{1, 1, 0, 1, 1, 1, 20, 36, 0, 0, 1, 1, 0, 0, 0},
+	{3, 1, 0, 1, 0, 1, 20, 36, 0, 0, 1, 1, 0, 0, 0},
+	{4, 1, 0, 1, 0, 1, 20, 36, 0, 0, 1, 1, 0, 0, 0},
+	{5, 1, 0, 1, 0, 1, 20, 36, 0, 0, 1, 1, 0, 0, 0}
+};
+
+// Minimal LV2 host for the command line tools. Provides urid:map, the
+// control and notify atom ports, the controller ports and state save /
+// restore for a single plugin instance. Stored properties other than the
+// shape data are kept in the host until the next save.
+class Host
+{
+public:
+	Host (const LV2_Descriptor* descriptor, const double rate, const uint32_t maxBlockSize);
+	~Host ();
+
+	LV2_URID map (const char* uri);
+	int getControllerNr (const std::string& symbol) const;
+	void setController (const int nr, const float value);
+	float getController (const int nr) const;
+
+	void addTimePosition (const uint32_t frame, const int64_t bar, const float barBeat, const float bpm,
+			      const float beatsPerBar, const int32_t beatUnit, const float speed);
+	void addMidi (const uint32_t frame, const uint8_t* msg, const uint32_t size);
+	void addObject (const uint32_t frame, const LV2_URID otype);
+	void addAtom (const uint32_t frame, const LV2_Atom* atom);
+	void addShape (const uint32_t frame, const int shapeNr, const std::vector<float>& nodeData);
+	void addRuntimeThreshold (const uint32_t frame, const float threshold);
+	void addParameter (const uint32_t frame, const int nr, const float value);
+	bool saveShapes (std::string& shapeData);
+	bool restoreShapes (const std::string& shapeData);
+	void run (const float* input1, const float* input2, float* output1, float* output2, const uint32_t n);
+
+	const LV2_Atom_Sequence* getNotifySequence () const;
+	uint32_t getNotifySize () const;
+
+	double rate;
+	uint32_t maxBlockSize;
+
+protected:
+	static LV2_URID mapUri (LV2_URID_Map_Handle handle, const char* uri);
+	static LV2_State_Status store (LV2_State_Handle handle, uint32_t key, const void* value, size_t size, uint32_t type, uint32_t flags);
+	static const void* retrieve (LV2_State_Handle handle, uint32_t key, size_t* size, uint32_t* type, uint32_t* flags);
+	const LV2_State_Interface* getStateInterface () const;
+	void openSequence ();
+
+	const LV2_Descriptor* descriptor;
+	LV2_Handle instance;
+	std::map<std::string, LV2_URID> uris;
+	LV2_URID_Map uridMap;
+	LV2_Feature uridMapFeature;
+
+	std::vector<uint64_t> controlBuffer;
+	std::vector<uint64_t> notifyBuffer;
+	LV2_Atom_Forge forge;
+	LV2_Atom_Forge_Frame sequenceFrame;
+	float controllers[NR_CONTROLLERS];
+
+#ifdef SUPPORTS_CV
+	std::vector<float> cvBuffer[MAXSHAPES];
+#endif
+
+	std::string stateShape;
+	std::map<uint32_t, std::pair<uint32_t, std::string>> stateProperties;	// Other properties (type, data) of the last save
+	LV2_URID stateShapeUrid;
+	LV2_URID stringUrid;
+};
+
+Host::Host (const LV2_Descriptor* descriptor, const double rate, const uint32_t maxBlockSize) :
+	rate (rate), maxBlockSize (maxBlockSize),
+	descriptor (descriptor), instance (nullptr), uris (),
+	uridMap {this, mapUri}, uridMapFeature {LV2_URID__map, &uridMap},
+	controlBuffer (HOST_ATOMBUFFERSIZE / sizeof (uint64_t), 0),
+	notifyBuffer (HOST_ATOMBUFFERSIZE / sizeof (uint64_t), 0),
+	forge (), sequenceFrame (), controllers {0},
+	stateShape (), stateProperties (), stateShapeUrid (0), stringUrid (0)
+{
+	if (!descriptor) throw std::invalid_argument ("No plugin descriptor");
+
+	const LV2_Feature* features[] = {&uridMapFeature, nullptr};
+	instance = descriptor->instantiate (descriptor, rate, "", features);
+	if (!instance) throw std::runtime_error ("Plugin instantiation failed");
+
+	stateShapeUrid = map (BSHAPR_URI "#STATEshape");
+	stringUrid = map (LV2_ATOM__String);
+	lv2_atom_forge_init (&forge, &uridMap);
+	openSequence ();
+
+	descriptor->connect_port (instance, CONTROL, controlBuffer.data ());
+	descriptor->connect_port (instance, NOTIFY, notifyBuffer.data ());
+
+	for (int i = 0; i < SHAPERS; ++i) controllers[i] = globalControllerDefaults[i];
+	for (int sh = 0; sh < MAXSHAPES; ++sh)
+	{
+		for (int i = 0; i < SH_SIZE; ++i) controllers[SHAPERS + sh * SH_SIZE + i] = shapeControllerDefaults[sh][i];
+	}
+	for (int i = 0; i < NR_CONTROLLERS; ++i) descriptor->connect_port (instance, CONTROLLERS + i, &controllers[i]);
+
+#ifdef SUPPORTS_CV
+	for (int i = 0; i < MAXSHAPES; ++i)
+	{
+		cvBuffer[i].resize (maxBlockSize, 0.0f);
+		descriptor->connect_port (instance, CV_OUT + i, cvBuffer[i].data ());
+	}
+#endif
+
+	if (descriptor->activate) descriptor->activate (instance);
+}
+
+Host::~Host ()
+{
+	if (descriptor->deactivate) descriptor->deactivate (instance);
+	descriptor->cleanup (instance);
+}
+
+LV2_URID Host::map (const char* uri)
+{
+	std::map<std::string, LV2_URID>::const_iterator it = uris.find (uri);
+	if (it != uris.end ()) return it->second;
+
+	const LV2_URID urid = uris.size () + 1;
+	uris[uri] = urid;
+	return urid;
+}
+
+LV2_URID Host::mapUri (LV2_URID_Map_Handle handle, const char* uri) {return ((Host*) handle)->map (uri);}
+
+int Host::getControllerNr (const std::string& symbol) const
+{
+	for (int i = 0; i < NR_CONTROLLERS; ++i)
+	{
+		if (symbol == getControllerSymbol (i)) return i;
+	}
+
+	return -1;
+}
+
+void Host::setController (const int nr, const float value)
+{
+	if ((nr >= 0) && (nr < NR_CONTROLLERS)) controllers[nr] = value;
+}
+
+float Host::getController (const int nr) const
+{
+	return ((nr >= 0) && (nr < NR_CONTROLLERS) ? controllers[nr] : 0.0f);
+}
+
+void Host::openSequence ()
+{
+	lv2_atom_forge_set_buffer (&forge, (uint8_t*) controlBuffer.data (), controlBuffer.size () * sizeof (uint64_t));
+	lv2_atom_forge_sequence_head (&forge, &sequenceFrame, 0);
+}
+
+void Host::addTimePosition (const uint32_t frame, const int64_t bar, const float barBeat, const float bpm,
+			    const float beatsPerBar, const int32_t beatUnit, const float speed)
+{
+	LV2_Atom_Forge_Frame frm;
+	lv2_atom_forge_frame_time (&forge, frame);
+	lv2_atom_forge_object (&forge, &frm, 0, map (LV2_TIME__Position));
+	lv2_atom_forge_key (&forge, map (LV2_TIME__bar));
+	lv2_atom_forge_long (&forge, bar);
+	lv2_atom_forge_key (&forge, map (LV2_TIME__barBeat));
+	lv2_atom_forge_float (&forge, barBeat);
+	lv2_atom_forge_key (&forge, map (LV2_TIME__beatsPerBar));
+	lv2_atom_forge_float (&forge, beatsPerBar);
+	lv2_atom_forge_key (&forge, map (LV2_TIME__beatUnit));
+	lv2_atom_forge_int (&forge, beatUnit);
+	lv2_atom_forge_key (&forge, map (LV2_TIME__beatsPerMinute));
+	lv2_atom_forge_float (&forge, bpm);
+	lv2_atom_forge_key (&forge, map (LV2_TIME__speed));
+	lv2_atom_forge_float (&forge, speed);
+	lv2_atom_forge_pop (&forge, &frm);
+}
+
+void Host::addMidi (const uint32_t frame, const uint8_t* msg, const uint32_t size)
+{
+	LV2_Atom midiatom;
+	midiatom.type = map (LV2_MIDI__MidiEvent);
+	midiatom.size = size;
+
+	lv2_atom_forge_frame_time (&forge, frame);
+	lv2_atom_forge_raw (&forge, &midiatom, sizeof (LV2_Atom));
+	lv2_atom_forge_raw (&forge, msg, size);
+	lv2_atom_forge_pad (&forge, sizeof (LV2_Atom) + size);
+}
+
+void Host::addObject (const uint32_t frame, const LV2_URID otype)
+{
+	LV2_Atom_Forge_Frame frm;
+	lv2_atom_forge_frame_time (&forge, frame);
+	lv2_atom_forge_object (&forge, &frm, 0, otype);
+	lv2_atom_forge_pop (&forge, &frm);
+}
+
+void Host::addAtom (const uint32_t frame, const LV2_Atom* atom)
+{
+	lv2_atom_forge_frame_time (&forge, frame);
+	lv2_atom_forge_raw (&forge, atom, sizeof (LV2_Atom) + atom->size);
+	lv2_atom_forge_pad (&forge, sizeof (LV2_Atom) + atom->size);
+}
+
+// Full shape data as sent by the GUI: 7 floats per node (type, point,
+// handle1, handle2)
+void Host::addShape (const uint32_t frame, const int shapeNr, const std::vector<float>& nodeData)
+{
+	LV2_Atom_Forge_Frame frm;
+	lv2_atom_forge_frame_time (&forge, frame);
+	lv2_atom_forge_object (&forge, &frm, 0, map (BSHAPR_URI "#NOTIFYshapeEvent"));
+	lv2_atom_forge_key (&forge, map (BSHAPR_URI "#NOTIFYshapeNr"));
+	lv2_atom_forge_int (&forge, shapeNr);
+	lv2_atom_forge_key (&forge, map (BSHAPR_URI "#NOTIFYshapeData"));
+	lv2_atom_forge_vector (&forge, sizeof (float), map (LV2_ATOM__Float), nodeData.size (), nodeData.data ());
+	lv2_atom_forge_pop (&forge, &frm);
+}
+
+// Threshold (fraction of the block real-time budget) for the run () time
+// overload telemetry
+void Host::addRuntimeThreshold (const uint32_t frame, const float threshold)
+{
+	LV2_Atom_Forge_Frame frm;
+	lv2_atom_forge_frame_time (&forge, frame);
+	lv2_atom_forge_object (&forge, &frm, 0, map (BSHAPR_URI "#NOTIFYruntimeEvent"));
+	lv2_atom_forge_key (&forge, map (BSHAPR_URI "#NOTIFYruntimeThreshold"));
+	lv2_atom_forge_float (&forge, threshold);
+	lv2_atom_forge_pop (&forge, &frm);
+}
+
+void Host::addParameter (const uint32_t frame, const int nr, const float value)
+{
+	LV2_Atom_Forge_Frame frm;
+	lv2_atom_forge_frame_time (&forge, frame);
+	lv2_atom_forge_object (&forge, &frm, 0, map (LV2_PATCH__Set));
+	lv2_atom_forge_key (&forge, map (LV2_PATCH__property));
+	lv2_atom_forge_urid (&forge, map (getControllerUri (nr).c_str ()));
+	lv2_atom_forge_key (&forge, map (LV2_PATCH__value));
+	lv2_atom_forge_float (&forge, value);
+	lv2_atom_forge_pop (&forge, &frm);
+}
+
+LV2_State_Status Host::store (LV2_State_Handle handle, uint32_t key, const void* value, size_t size, uint32_t type, uint32_t flags)
+{
+	Host* host = (Host*) handle;
+	if (size == 0) return LV2_STATE_ERR_NO_PROPERTY;
+
+	if (key == host->stateShapeUrid)
+	{
+		if (type != host->stringUrid) return LV2_STATE_ERR_BAD_TYPE;
+		host->stateShape = std::string ((const char*) value, size - 1);
+	}
+
+	else host->stateProperties[key] = std::make_pair (type, std::string ((const char*) value, size));
+	return LV2_STATE_SUCCESS;
+}
+
+const void* Host::retrieve (LV2_State_Handle handle, uint32_t key, size_t* size, uint32_t* type, uint32_t* flags)
+{
+	Host* host = (Host*) handle;
+	if (key != host->stateShapeUrid)
+	{
+		std::map<uint32_t, std::pair<uint32_t, std::string>>::const_iterator it = host->stateProperties.find (key);
+		if (it == host->stateProperties.end ()) return nullptr;
+
+		*size = it->second.second.size ();
+		*type = it->second.first;
+		*flags = LV2_STATE_IS_POD;
+		return it->second.second.data ();
+	}
+
+	*size = host->stateShape.size () + 1;
+	*type = host->stringUrid;
+	*flags = LV2_STATE_IS_POD;
+	return host->stateShape.c_str ();
+}
+
+const LV2_State_Interface* Host::getStateInterface () const
+{
+	if (!descriptor->extension_data) return nullptr;
+	return (const LV2_State_Interface*) descriptor->extension_data (LV2_STATE__interface);
+}
+
+bool Host::saveShapes (std::string& shapeData)
+{
+	const LV2_State_Interface* state = getStateInterface ();
+	if (!state) return false;
+
+	stateShape.clear ();
+	stateProperties.clear ();
+	const LV2_Feature* features[] = {&uridMapFeature, nullptr};
+	if (state->save (instance, store, this, 0, features) != LV2_STATE_SUCCESS) return false;
+	shapeData = stateShape;
+	return true;
+}
+
+bool Host::restoreShapes (const std::string& shapeData)
+{
+	const LV2_State_Interface* state = getStateInterface ();
+	if (!state) return false;
+
+	stateShape = shapeData;
+	const LV2_Feature* features[] = {&uridMapFeature, nullptr};
+	return (state->restore (instance, retrieve, this, 0, features) == LV2_STATE_SUCCESS);
+}
+
+void Host::run (const float* input1, const float* input2, float* output1, float* output2, const uint32_t n)
+{
+	if (n > maxBlockSize) throw std::invalid_argument ("Block size exceeds maxBlockSize");
+
+	// Close control sequence, provide notify buffer capacity
+	lv2_atom_forge_pop (&forge, &sequenceFrame);
+	LV2_Atom* notify = (LV2_Atom*) notifyBuffer.data ();
+	notify->size = notifyBuffer.size () * sizeof (uint64_t) - sizeof (LV2_Atom);
+	notify->type = 0;
+
+	descriptor->connect_port (instance, AUDIO_IN_1, (void*) input1);
+	descriptor->connect_port (instance, AUDIO_IN_2, (void*) input2);
+	descriptor->connect_port (instance, AUDIO_OUT_1, output1);
+	descriptor->connect_port (instance, AUDIO_OUT_2, output2);
+	descriptor->run (instance, n);
+
+	// Empty control sequence for the next cycle
+	openSequence ();
+}
+
+const LV2_Atom_Sequence* Host::getNotifySequence () const {return (const LV2_Atom_Sequence*) notifyBuffer.data ();}
+
+uint32_t Host::getNotifySize () const {return getNotifySequence ()->atom.size;}
+
+#endif /* HOST_HPP_ */
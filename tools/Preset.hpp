@@ -0,0 +1,190 @@
+/* B.Shapr
+ * Beat / envelope shaper LV2 plugin
+ *
+ * Copyright (C) 2019 by Sven Jähnichen
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#ifndef PRESET_HPP_
+#define PRESET_HPP_
+
+#include <cstdint>
+#include <cmath>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include "Host.hpp"
+
+// Plugin preset as plain text. Each line contains either a controller
+// symbol (as defined in BShapr.ttl) followed by its value, e.g.
+//	sh1_target 3
+// or a node in the plugin state format, e.g.
+//	shp:0; met:3; typ:0; ptx:0.0; pty:0.5; h1x:0.0; h1y:0.0; h2x:0.0; h2y:0.0
+// Empty lines and lines starting with # are ignored.
+struct Preset
+{
+	std::vector<std::pair<std::string, float>> controllers;
+	std::string shapes;
+
+	void read (const std::string& filename);
+	void apply (Host& host) const;
+};
+
+void Preset::read (const std::string& filename)
+{
+	std::ifstream file (filename);
+	if (!file) throw std::runtime_error ("Can't open " + filename);
+
+	std::string line;
+	int lineNr = 0;
+	while (std::getline (file, line))
+	{
+		++lineNr;
+		const size_t start = line.find_first_not_of (" \t\r");
+		if ((start == std::string::npos) || (line[start] == '#')) continue;
+
+		if (line.compare (start, 4, "shp:") == 0) shapes += line.substr (start) + "\n";
+		else
+		{
+			std::istringstream iss (line);
+			std::string symbol;
+			float value;
+			if (!(iss >> symbol >> value))
+			{
+				throw std::runtime_error (filename + ":" + std::to_string (lineNr) + ": Can't parse \"" + line + "\"");
+			}
+			controllers.push_back (std::make_pair (symbol, value));
+		}
+	}
+}
+
+void Preset::apply (Host& host) const
+{
+	for (const std::pair<std::string, float>& c : controllers)
+	{
+		const int nr = host.getControllerNr (c.first);
+		if (nr < 0) throw std::runtime_error ("Unknown controller " + c.first);
+		host.setController (nr, c.second);
+	}
+
+	if ((!shapes.empty ()) && (!host.restoreShapes ("Shape data:\n" + shapes)))
+	{
+		throw std::runtime_error ("Can't restore shapes");
+	}
+}
+
+struct Tempo
+{
+	double time;
+	double bpm;
+	double beatsPerBar;
+	int32_t beatUnit;
+};
+
+struct TransportPosition
+{
+	int64_t bar;
+	double barBeat;
+	double bpm;
+	double beatsPerBar;
+	int32_t beatUnit;
+};
+
+// Tempo map as plain text. Each line contains the time in seconds, the
+// tempo in bpm and optionally the beats per bar and the beat unit, e.g.
+//	0.0 120 4 4
+//	8.0 90 3 4
+// Without a tempo map 120 bpm in 4/4 is used. A change of the meter
+// starts a new bar.
+struct TempoMap
+{
+	std::vector<Tempo> tempos = {{0.0, 120.0, 4.0, 4}};
+
+	void read (const std::string& filename);
+	size_t getIndex (const double time) const;
+	TransportPosition getPosition (const double time) const;
+};
+
+void TempoMap::read (const std::string& filename)
+{
+	std::ifstream file (filename);
+	if (!file) throw std::runtime_error ("Can't open " + filename);
+
+	std::vector<Tempo> newTempos;
+	std::string line;
+	int lineNr = 0;
+	while (std::getline (file, line))
+	{
+		++lineNr;
+		const size_t start = line.find_first_not_of (" \t\r");
+		if ((start == std::string::npos) || (line[start] == '#')) continue;
+
+		std::istringstream iss (line);
+		Tempo t = {0.0, 120.0, 4.0, 4};
+		if (!newTempos.empty ()) {t.beatsPerBar = newTempos.back ().beatsPerBar; t.beatUnit = newTempos.back ().beatUnit;}
+		if (!(iss >> t.time >> t.bpm) || (t.bpm <= 0.0) || (t.time < (newTempos.empty () ? 0.0 : newTempos.back ().time)))
+		{
+			throw std::runtime_error (filename + ":" + std::to_string (lineNr) + ": Invalid tempo \"" + line + "\"");
+		}
+		if (iss >> t.beatsPerBar) iss >> t.beatUnit;
+		if ((t.beatsPerBar <= 0.0) || (t.beatUnit <= 0))
+		{
+			throw std::runtime_error (filename + ":" + std::to_string (lineNr) + ": Invalid meter \"" + line + "\"");
+		}
+		newTempos.push_back (t);
+	}
+
+	if (newTempos.empty ()) return;
+	if (newTempos.front ().time > 0.0) newTempos.insert (newTempos.begin (), Tempo {0.0, newTempos.front ().bpm, newTempos.front ().beatsPerBar, newTempos.front ().beatUnit});
+	tempos = newTempos;
+}
+
+size_t TempoMap::getIndex (const double time) const
+{
+	size_t idx = 0;
+	while ((idx + 1 < tempos.size ()) && (tempos[idx + 1].time <= time)) ++idx;
+	return idx;
+}
+
+TransportPosition TempoMap::getPosition (const double time) const
+{
+	double bars = 0.0;
+	for (size_t i = 0; i < tempos.size (); ++i)
+	{
+		const Tempo& t = tempos[i];
+		const bool isLast = (i + 1 >= tempos.size ()) || (tempos[i + 1].time > time);
+		const double end = (isLast ? time : tempos[i + 1].time);
+		const double beats = (end - t.time) * t.bpm / 60.0;
+
+		bars += beats / t.beatsPerBar;
+
+		if (isLast)
+		{
+			const double bar = floor (bars);
+			return TransportPosition {int64_t (bar), (bars - bar) * t.beatsPerBar, t.bpm, t.beatsPerBar, t.beatUnit};
+		}
+
+		// Meter change: Complete the running bar
+		const Tempo& next = tempos[i + 1];
+		if ((next.beatsPerBar != t.beatsPerBar) || (next.beatUnit != t.beatUnit)) bars = ceil (bars - 1e-9);
+	}
+
+	return TransportPosition {0, 0.0, tempos.front ().bpm, tempos.front ().beatsPerBar, tempos.front ().beatUnit};
+}
+
+#endif /* PRESET_HPP_ */
@@ -0,0 +1,88 @@
+/* B.Shapr
+ * Beat / envelope shaper LV2 plugin
+ *
+ * Copyright (C) 2019 by Sven Jähnichen
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#ifndef TARGETS_HPP_
+#define TARGETS_HPP_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "../src/Globals.hpp"
+
+const std::string targetNames[MAXEFFECTS] =
+{
+	"level", "balance", "width", "low_pass", "high_pass", "gain", "low_pass_log", "high_pass_log",
+	"pitch", "delay", "doppler", "distortion", "decimate", "bitcrush",
+#ifdef SUPPORTS_CV
+	"send_cv",
+#else
+	"send_midi",
+#endif
+	"reverb"
+};
+
+const std::string distortionNames[] = {"hardclip", "softclip", "foldback", "overdrive", "fuzz"};
+
+// Option setting of a target to be tested
+struct Variant
+{
+	std::string name;
+	int option;
+	float value;
+};
+
+// All filter orders of DB_PER_OCT_OPT and all distortion methods, otherwise
+// the default option values
+std::vector<Variant> getVariants (const int target)
+{
+	std::vector<Variant> variants;
+
+	for (int i = 0; i < MAXOPTIONWIDGETS; ++i)
+	{
+		const int opt = methods[target].optionIndexes[i];
+		if (opt == DB_PER_OCT_OPT)
+		{
+			const Limit& l = options[DB_PER_OCT_OPT].limit;
+			for (float v = l.min; v <= l.max; v += l.step) variants.push_back ({std::to_string (int (v)) + "db_oct", opt, v});
+		}
+
+		else if (opt == DISTORTION_OPT)
+		{
+			for (int v = HARDCLIP; v <= FUZZ; ++v) variants.push_back ({distortionNames[v], opt, float (v)});
+		}
+	}
+
+	if (variants.empty ()) variants.push_back ({"default", NO_OPT, 0.0f});
+	return variants;
+}
+
+// Deterministic white noise at -6 dB
+void fillNoise (float* buffer1, float* buffer2, const size_t n, uint32_t seed = 0x1234567)
+{
+	for (size_t i = 0; i < n; ++i)
+	{
+		seed = seed * 1664525 + 1013904223;
+		buffer1[i] = 0.5f * (float (seed >> 8) / 8388608.0f - 1.0f);
+		seed = seed * 1664525 + 1013904223;
+		buffer2[i] = 0.5f * (float (seed >> 8) / 8388608.0f - 1.0f);
+	}
+}
+
+#endif /* TARGETS_HPP_ */
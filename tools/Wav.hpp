@@ -0,0 +1,169 @@
+/* B.Shapr
+ * Beat / envelope shaper LV2 plugin
+ *
+ * Copyright (C) 2019 by Sven Jähnichen
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#ifndef WAV_HPP_
+#define WAV_HPP_
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <iterator>
+#include <algorithm>
+#include <stdexcept>
+
+// Stereo audio data as read from / written to a RIFF WAVE file. Mono files
+// are duplicated to both channels.
+struct Wav
+{
+	uint32_t rate = 48000;
+	std::vector<float> channel1;
+	std::vector<float> channel2;
+
+	size_t size () const {return channel1.size ();}
+	void resize (const size_t n) {channel1.resize (n, 0.0f); channel2.resize (n, 0.0f);}
+	void read (const std::string& filename);
+	void write (const std::string& filename) const;
+};
+
+namespace WavIO
+{
+
+static inline uint32_t getU16 (const uint8_t* p) {return p[0] | (p[1] << 8);}
+static inline uint32_t getU32 (const uint8_t* p) {return p[0] | (p[1] << 8) | (p[2] << 16) | (uint32_t (p[3]) << 24);}
+static inline void putU16 (std::ofstream& f, const uint16_t v) {const uint8_t b[2] = {uint8_t (v), uint8_t (v >> 8)}; f.write ((const char*) b, 2);}
+static inline void putU32 (std::ofstream& f, const uint32_t v)
+{
+	const uint8_t b[4] = {uint8_t (v), uint8_t (v >> 8), uint8_t (v >> 16), uint8_t (v >> 24)};
+	f.write ((const char*) b, 4);
+}
+
+static float getSample (const uint8_t* p, const uint32_t format, const uint32_t bits)
+{
+	if (format == 3)
+	{
+		if (bits == 32) {float f; memcpy (&f, p, 4); return f;}
+		if (bits == 64) {double d; memcpy (&d, p, 8); return d;}
+	}
+
+	else
+	{
+		switch (bits)
+		{
+			case 8:		return (float (p[0]) - 128.0f) / 128.0f;
+			case 16:	return float (int16_t (getU16 (p))) / 32768.0f;
+			case 24:	return float (int32_t ((uint32_t (p[0]) << 8) | (uint32_t (p[1]) << 16) | (uint32_t (p[2]) << 24)) >> 8) / 8388608.0f;
+			case 32:	return float (int32_t (getU32 (p))) / 2147483648.0f;
+			default:	break;
+		}
+	}
+
+	throw std::runtime_error ("Unsupported WAV sample format");
+}
+
+}
+
+void Wav::read (const std::string& filename)
+{
+	std::ifstream file (filename, std::ios::binary);
+	if (!file) throw std::runtime_error ("Can't open " + filename);
+	std::vector<uint8_t> data ((std::istreambuf_iterator<char> (file)), std::istreambuf_iterator<char> ());
+
+	if ((data.size () < 12) || memcmp (data.data (), "RIFF", 4) || memcmp (data.data () + 8, "WAVE", 4))
+	{
+		throw std::runtime_error (filename + " is not a RIFF WAVE file");
+	}
+
+	uint32_t format = 0;
+	uint32_t channels = 0;
+	uint32_t bits = 0;
+	const uint8_t* samples = nullptr;
+	size_t samplesSize = 0;
+
+	for (size_t pos = 12; pos + 8 <= data.size (); )
+	{
+		const uint8_t* chunk = data.data () + pos;
+		const size_t chunkSize = WavIO::getU32 (chunk + 4);
+		const size_t available = std::min (chunkSize, data.size () - pos - 8);
+
+		if ((!memcmp (chunk, "fmt ", 4)) && (available >= 16))
+		{
+			format = WavIO::getU16 (chunk + 8);
+			channels = WavIO::getU16 (chunk + 10);
+			rate = WavIO::getU32 (chunk + 12);
+			bits = WavIO::getU16 (chunk + 22);
+
+			// WAVE_FORMAT_EXTENSIBLE: format code is stored in the sub format GUID
+			if ((format == 0xFFFE) && (available >= 26)) format = WavIO::getU16 (chunk + 32);
+		}
+
+		else if (!memcmp (chunk, "data", 4))
+		{
+			samples = chunk + 8;
+			samplesSize = available;
+		}
+
+		pos += 8 + chunkSize + (chunkSize & 1);
+	}
+
+	if ((!samples) || (channels == 0) || (bits == 0) || (bits % 8)) throw std::runtime_error (filename + " has no valid fmt or data chunk");
+	if ((format != 1) && (format != 3)) throw std::runtime_error (filename + ": Only PCM and IEEE float WAV files are supported");
+
+	const size_t bytesPerSample = bits / 8;
+	const size_t frames = samplesSize / (bytesPerSample * channels);
+	resize (frames);
+	for (size_t i = 0; i < frames; ++i)
+	{
+		const uint8_t* frame = samples + i * bytesPerSample * channels;
+		channel1[i] = WavIO::getSample (frame, format, bits);
+		channel2[i] = (channels > 1 ? WavIO::getSample (frame + bytesPerSample, format, bits) : channel1[i]);
+	}
+}
+
+void Wav::write (const std::string& filename) const
+{
+	std::ofstream file (filename, std::ios::binary);
+	if (!file) throw std::runtime_error ("Can't write " + filename);
+
+	const uint32_t dataSize = size () * 2 * sizeof (float);
+	file.write ("RIFF", 4);
+	WavIO::putU32 (file, 36 + dataSize);
+	file.write ("WAVEfmt ", 8);
+	WavIO::putU32 (file, 16);
+	WavIO::putU16 (file, 3);
+	WavIO::putU16 (file, 2);
+	WavIO::putU32 (file, rate);
+	WavIO::putU32 (file, rate * 2 * sizeof (float));
+	WavIO::putU16 (file, 2 * sizeof (float));
+	WavIO::putU16 (file, 32);
+	file.write ("data", 4);
+	WavIO::putU32 (file, dataSize);
+
+	for (size_t i = 0; i < size (); ++i)
+	{
+		file.write ((const char*) &channel1[i], sizeof (float));
+		file.write ((const char*) &channel2[i], sizeof (float));
+	}
+
+	if (!file) throw std::runtime_error ("Can't write " + filename);
+}
+
+#endif /* WAV_HPP_ */
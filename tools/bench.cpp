@@ -0,0 +1,187 @@
+/* B.Shapr
+ * Beat / envelope shaper LV2 plugin
+ *
+ * Copyright (C) 2019 by Sven Jähnichen
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+// DSP microbenchmark. Runs a single shaper (the other shapers switched off)
+// connected to each target effect (and each of its option variants) for a
+// range of sample rates and block sizes and prints the results as CSV to
+// stdout:
+//	target,variant,rate,blocksize,ns_per_sample,worst_block_us,cycles_per_sample
+// Cycles are TSC reference cycles and only available on x86 (0 otherwise).
+// Usage:
+//	bshapr-bench [-s seconds] [-t target] [-r rate] [-b blocksize]
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <exception>
+#include <getopt.h>
+#if defined (__x86_64__) || defined (__i386__)
+#include <x86intrin.h>
+#endif
+#include "Host.hpp"
+#include "Targets.hpp"
+
+const double benchRates[] = {44100.0, 48000.0, 96000.0, 192000.0};
+const uint32_t benchBlockSizes[] = {16, 32, 64, 128, 256, 512, 1024, 2048, 4096};
+
+struct BenchResult
+{
+	double nsPerSample;
+	double worstBlockUs;
+	double cyclesPerSample;
+};
+
+static inline uint64_t readCycles ()
+{
+#if defined (__x86_64__) || defined (__i386__)
+	return __rdtsc ();
+#else
+	return 0;
+#endif
+}
+
+static BenchResult bench (const int target, const Variant& variant, const double rate, const uint32_t blockSize, const double seconds)
+{
+	Host host (lv2_descriptor (0), rate, blockSize);
+	host.setController (BASE, SECONDS);
+	host.setController (SHAPERS + SH_INPUT, AUDIO_IN);
+	host.setController (SHAPERS + SH_TARGET, target);
+	host.setController (SHAPERS + SH_OUTPUT, AUDIO_OUT);
+	if (variant.option != NO_OPT) host.setController (SHAPERS + SH_OPTION + variant.option, variant.value);
+
+	// Switch off the other shapers (TTL default: chained Level shapers)
+	for (int sh = 1; sh < MAXSHAPES; ++sh) host.setController (SHAPERS + sh * SH_SIZE + SH_INPUT, OFF);
+
+	std::vector<float> input1 (blockSize);
+	std::vector<float> input2 (blockSize);
+	std::vector<float> output1 (blockSize);
+	std::vector<float> output2 (blockSize);
+	fillNoise (input1.data (), input2.data (), blockSize);
+
+	// Warm up: Fill buffers, settle faders
+	const uint64_t warmupBlocks = uint64_t (0.1 * rate / blockSize) + 1;
+	for (uint64_t b = 0; b < warmupBlocks; ++b) host.run (input1.data (), input2.data (), output1.data (), output2.data (), blockSize);
+
+	const uint64_t nrBlocks = uint64_t (seconds * rate / blockSize) + 1;
+	double worst = 0.0;
+	const std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now ();
+	const uint64_t c0 = readCycles ();
+
+	for (uint64_t b = 0; b < nrBlocks; ++b)
+	{
+		const std::chrono::steady_clock::time_point tb = std::chrono::steady_clock::now ();
+		host.run (input1.data (), input2.data (), output1.data (), output2.data (), blockSize);
+		const double dt = std::chrono::duration<double, std::micro> (std::chrono::steady_clock::now () - tb).count ();
+		if (dt > worst) worst = dt;
+	}
+
+	const uint64_t c1 = readCycles ();
+	const double total = std::chrono::duration<double, std::nano> (std::chrono::steady_clock::now () - t0).count ();
+	const double samples = double (nrBlocks) * blockSize;
+	return BenchResult {total / samples, worst, double (c1 - c0) / samples};
+}
+
+static void usage (const char* name)
+{
+	fprintf (stderr, "Usage: %s [-s seconds] [-t target] [-r rate] [-b blocksize]\n", name);
+	fprintf (stderr, "  -s seconds    Audio time processed per configuration (default 1.0)\n");
+	fprintf (stderr, "  -t target     Only benchmark this target (0..%i or name)\n", MAXEFFECTS - 1);
+	fprintf (stderr, "  -r rate       Only benchmark this sample rate\n");
+	fprintf (stderr, "  -b blocksize  Only benchmark this block size\n");
+}
+
+int main (int argc, char** argv)
+{
+	double seconds = 1.0;
+	int onlyTarget = -1;
+	double onlyRate = 0.0;
+	uint32_t onlyBlockSize = 0;
+
+	int opt;
+	while ((opt = getopt (argc, argv, "s:t:r:b:h")) != -1)
+	{
+		switch (opt)
+		{
+			case 's':	seconds = atof (optarg);
+					break;
+			case 't':	onlyTarget = -2;
+					for (int i = 0; i < MAXEFFECTS; ++i)
+					{
+						if ((targetNames[i] == optarg) || (std::to_string (i) == optarg)) onlyTarget = i;
+					}
+					break;
+			case 'r':	onlyRate = atof (optarg);
+					break;
+			case 'b':	onlyBlockSize = atoi (optarg);
+					break;
+			default:	usage (argv[0]);
+					return (opt == 'h' ? 0 : 1);
+		}
+	}
+
+	if ((optind != argc) || (seconds <= 0.0) || (onlyTarget == -2))
+	{
+		usage (argv[0]);
+		return 1;
+	}
+
+	std::vector<double> rates (std::begin (benchRates), std::end (benchRates));
+	if (onlyRate > 0.0) rates = {onlyRate};
+	std::vector<uint32_t> blockSizes (std::begin (benchBlockSizes), std::end (benchBlockSizes));
+	if (onlyBlockSize > 0) blockSizes = {onlyBlockSize};
+
+	try
+	{
+		printf ("target,variant,rate,blocksize,ns_per_sample,worst_block_us,cycles_per_sample\n");
+		for (int t = 0; t < MAXEFFECTS; ++t)
+		{
+			if ((onlyTarget >= 0) && (t != onlyTarget)) continue;
+
+			for (const Variant& v : getVariants (t))
+			{
+				for (double r : rates)
+				{
+					for (uint32_t b : blockSizes)
+					{
+						const BenchResult res = bench (t, v, r, b, seconds);
+						printf
+						(
+							"%s,%s,%.0f,%u,%.3f,%.3f,%.1f\n",
+							targetNames[t].c_str (), v.name.c_str (), r, b,
+							res.nsPerSample, res.worstBlockUs, res.cyclesPerSample
+						);
+						fflush (stdout);
+					}
+				}
+			}
+		}
+	}
+
+	catch (const std::exception& e)
+	{
+		fprintf (stderr, "%s: %s\n", argv[0], e.what ());
+		return 1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,404 @@
+/* B.Shapr
+ * Beat / envelope shaper LV2 plugin
+ *
+ * Copyright (C) 2019 by Sven Jähnichen
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+// Golden output regression check. Renders a reference signal through each
+// target effect (and each of its option variants) in each routing:
+//	audio		Audio in -> target -> audio out
+//	constant	Constant input -> target -> audio out
+//	chain		Audio in -> target -> internal -> level (shaper 2) -> audio out
+// With -w, the renderings are stored as golden files in the given
+// directory. Otherwise the renderings are compared against the golden
+// files using per-target tolerances (max. absolute error, min. SNR, max.
+// share of quantization steps). Golden files only keep every
+// GOLDEN_DECIMATION-th frame with 24 bit resolution (scaled to the channel
+// peak). The golden files in tools/golden were rendered with the DSP code
+// before the optimization series (make golden-check). Usage:
+//	bshapr-golden [-w] [-t target] directory
+// Returns 1 if a comparison fails or a golden file is missing.
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <exception>
+#include <stdexcept>
+#include <getopt.h>
+#include "Host.hpp"
+#include "Targets.hpp"
+
+#define GOLDEN_MAGIC "BSGOLD2"
+#define GOLDEN_RATE 48000
+#define GOLDEN_FRAMES 16384
+#define GOLDEN_BLOCKSIZE 256
+#define GOLDEN_DECIMATION 32
+#define GOLDEN_SAMPLES (GOLDEN_FRAMES / GOLDEN_DECIMATION)
+#define GOLDEN_INT24_MAX 8388607
+#define GOLDEN_LOW_LEVEL 0.03
+
+enum Routing
+{
+	AUDIO_ROUTING		= 0,
+	CONSTANT_ROUTING	= 1,
+	CHAIN_ROUTING		= 2,
+	NR_ROUTINGS		= 3
+};
+
+const std::string routingNames[NR_ROUTINGS] = {"audio", "constant", "chain"};
+
+struct Tolerance
+{
+	double maxAbsError;
+	double minSnr;
+	double maxStepShare;
+};
+
+// Linear targets are expected to stay (nearly) bit exact. Interpolating and
+// feedback targets may differ more. Quantizing targets (decimate, bitcrush)
+// may flip single steps: Up to maxStepShare of the samples may exceed
+// maxAbsError, the rendering must still meet the SNR.
+const Tolerance tolerances[MAXEFFECTS] =
+{
+	{1e-5, 100.0, 0.0},	// level
+	{1e-5, 100.0, 0.0},	// balance
+	{1e-5, 100.0, 0.0},	// width
+	{1e-4, 80.0, 0.0},	// low_pass
+	{1e-4, 80.0, 0.0},	// high_pass
+	{1e-5, 100.0, 0.0},	// gain
+	{1e-4, 80.0, 0.0},	// low_pass_log
+	{1e-4, 80.0, 0.0},	// high_pass_log
+	{1e-3, 60.0, 0.0},	// pitch
+	{1e-3, 60.0, 0.0},	// delay
+	{1e-3, 60.0, 0.0},	// doppler
+	{1e-4, 80.0, 0.0},	// distortion
+	{1e-4, 40.0, 0.01},	// decimate
+	{1e-4, 40.0, 0.01},	// bitcrush
+	{1e-5, 100.0, 0.0},	// send
+	{1e-3, 60.0, 0.0}	// reverb
+};
+
+// Raw shape (triangle) sent to the shaper: end node, point node, end node
+const std::vector<float> goldenShape =
+{
+	0, 0.0, 0.0, 0, 0, 0, 0,
+	1, 0.5, 0.8, 0, 0, 0, 0,
+	0, 1.0, 0.0, 0, 0, 0, 0
+};
+
+// Raw shape for the quantizing targets. The golden shape would only result in
+// > 48 kHz (decimate) or > 16 bits (bitcrush). This one sweeps 2.4 - 19.2 kHz
+// and 1 - 6.4 bits.
+const std::vector<float> quantizerShape =
+{
+	0, 0.0, -0.95, 0, 0, 0, 0,
+	1, 0.5, -0.6, 0, 0, 0, 0,
+	0, 1.0, -0.95, 0, 0, 0, 0
+};
+
+struct Rendering
+{
+	std::vector<float> channel1;
+	std::vector<float> channel2;
+};
+
+// Golden file content: Decimated rendering with 24 bit resolution
+struct Golden
+{
+	float scale1;
+	float scale2;
+	std::vector<int32_t> channel1;
+	std::vector<int32_t> channel2;
+};
+
+static Rendering render (const int target, const Variant& variant, const Routing routing)
+{
+	Host host (lv2_descriptor (0), GOLDEN_RATE, GOLDEN_BLOCKSIZE);
+	host.setController (BASE, SECONDS);
+	host.setController (BASE_VALUE, 0.1);
+	host.setController (SHAPERS + SH_INPUT, (routing == CONSTANT_ROUTING ? CONSTANT : AUDIO_IN));
+	host.setController (SHAPERS + SH_TARGET, target);
+	host.setController (SHAPERS + SH_OUTPUT, (routing == CHAIN_ROUTING ? INTERNAL : AUDIO_OUT));
+	if (variant.option != NO_OPT) host.setController (SHAPERS + SH_OPTION + variant.option, variant.value);
+	if (routing == CHAIN_ROUTING)
+	{
+		host.setController (SHAPERS + SH_SIZE + SH_INPUT, OUTPUT);
+		host.setController (SHAPERS + SH_SIZE + SH_TARGET, LEVEL);
+		host.setController (SHAPERS + SH_SIZE + SH_OUTPUT, AUDIO_OUT);
+	}
+	else host.setController (SHAPERS + SH_SIZE + SH_INPUT, OFF);
+
+	// Switch off the other shapers (TTL default: chained Level shapers)
+	for (int sh = 2; sh < MAXSHAPES; ++sh) host.setController (SHAPERS + sh * SH_SIZE + SH_INPUT, OFF);
+	host.addShape (0, 0, ((target == DECIMATE) || (target == BITCRUSH) ? quantizerShape : goldenShape));
+
+	// Reference signal: Noise plus a 441 Hz sine
+	std::vector<float> input1 (GOLDEN_FRAMES);
+	std::vector<float> input2 (GOLDEN_FRAMES);
+	fillNoise (input1.data (), input2.data (), GOLDEN_FRAMES);
+	for (size_t i = 0; i < GOLDEN_FRAMES; ++i)
+	{
+		const float s = 0.4f * sin (2.0 * M_PI * 441.0 * i / GOLDEN_RATE);
+		input1[i] = 0.5f * input1[i] + s;
+		input2[i] = 0.5f * input2[i] - s;
+	}
+
+	Rendering r;
+	r.channel1.resize (GOLDEN_FRAMES, 0.0f);
+	r.channel2.resize (GOLDEN_FRAMES, 0.0f);
+	for (size_t start = 0; start < GOLDEN_FRAMES; start += GOLDEN_BLOCKSIZE)
+	{
+		host.run (&input1[start], &input2[start], &r.channel1[start], &r.channel2[start], GOLDEN_BLOCKSIZE);
+	}
+
+	return r;
+}
+
+static float getPeak (const std::vector<float>& channel)
+{
+	float peak = 0.0f;
+	for (size_t i = 0; i < GOLDEN_FRAMES; i += GOLDEN_DECIMATION)
+	{
+		if (!std::isfinite (channel[i])) throw std::runtime_error ("Rendering contains NaN or inf");
+		peak = std::max (peak, fabsf (channel[i]));
+	}
+	return peak;
+}
+
+static void writeChannel (std::ofstream& file, const std::vector<float>& channel, const float scale)
+{
+	for (size_t i = 0; i < GOLDEN_FRAMES; i += GOLDEN_DECIMATION)
+	{
+		const int32_t v = (scale == 0.0f ? 0 : int32_t (lrint (double (channel[i]) / scale * GOLDEN_INT24_MAX)));
+		const uint8_t bytes[3] = {uint8_t (v), uint8_t (v >> 8), uint8_t (v >> 16)};
+		file.write ((const char*) bytes, sizeof (bytes));
+	}
+}
+
+static void readChannel (std::ifstream& file, std::vector<int32_t>& channel)
+{
+	channel.resize (GOLDEN_SAMPLES);
+	for (int32_t& v : channel)
+	{
+		uint8_t bytes[3];
+		file.read ((char*) bytes, sizeof (bytes));
+		v = int32_t (uint32_t (bytes[0]) | (uint32_t (bytes[1]) << 8) | (uint32_t (bytes[2]) << 16));
+		if (v > GOLDEN_INT24_MAX) v -= 0x1000000;	// Sign extension
+	}
+}
+
+static void writeGolden (const std::string& filename, const Rendering& r)
+{
+	std::ofstream file (filename, std::ios::binary);
+	if (!file) throw std::runtime_error ("Can't write " + filename);
+
+	const uint32_t header[3] = {GOLDEN_RATE, GOLDEN_FRAMES, GOLDEN_DECIMATION};
+	const float scales[2] = {getPeak (r.channel1), getPeak (r.channel2)};
+	file.write (GOLDEN_MAGIC, sizeof (GOLDEN_MAGIC));
+	file.write ((const char*) header, sizeof (header));
+	file.write ((const char*) scales, sizeof (scales));
+	writeChannel (file, r.channel1, scales[0]);
+	writeChannel (file, r.channel2, scales[1]);
+	if (!file) throw std::runtime_error ("Can't write " + filename);
+}
+
+static bool readGolden (const std::string& filename, Golden& g)
+{
+	std::ifstream file (filename, std::ios::binary);
+	if (!file) return false;
+
+	char magic[sizeof (GOLDEN_MAGIC)];
+	uint32_t header[3];
+	file.read (magic, sizeof (magic));
+	file.read ((char*) header, sizeof (header));
+	if
+	(
+		(!file) || memcmp (magic, GOLDEN_MAGIC, sizeof (magic)) ||
+		(header[0] != GOLDEN_RATE) || (header[1] != GOLDEN_FRAMES) || (header[2] != GOLDEN_DECIMATION)
+	)
+	{
+		throw std::runtime_error (filename + " is not a compatible golden file");
+	}
+
+	file.read ((char*) &g.scale1, sizeof (g.scale1));
+	file.read ((char*) &g.scale2, sizeof (g.scale2));
+	readChannel (file, g.channel1);
+	readChannel (file, g.channel2);
+	if (!file) throw std::runtime_error (filename + " is truncated");
+	return true;
+}
+
+// Returns max. absolute error, SNR in dB (infinite if identical), the RMS
+// of the golden rendering and the share of samples exceeding maxAbsError.
+// The golden values are resolved to half a 24 bit step, this is added to
+// maxAbsError.
+static void compare
+(
+	const Golden& golden, const Rendering& r, const double tolerance,
+	double& maxAbsError, double& snr, double& rms, double& stepShare
+)
+{
+	const double q1 = golden.scale1 / GOLDEN_INT24_MAX;
+	const double q2 = golden.scale2 / GOLDEN_INT24_MAX;
+	const double limit1 = tolerance + 0.5 * q1;
+	const double limit2 = tolerance + 0.5 * q2;
+	double signal = 0.0;
+	double noise = 0.0;
+	size_t steps = 0;
+	maxAbsError = 0.0;
+
+	for (size_t i = 0; i < GOLDEN_SAMPLES; ++i)
+	{
+		const double g1 = golden.channel1[i] * q1;
+		const double g2 = golden.channel2[i] * q2;
+		const double d1 = double (r.channel1[i * GOLDEN_DECIMATION]) - g1;
+		const double d2 = double (r.channel2[i * GOLDEN_DECIMATION]) - g2;
+		signal += g1 * g1 + g2 * g2;
+		noise += d1 * d1 + d2 * d2;
+
+		// NaN or inf always fails
+		if (!std::isfinite (d1) || !std::isfinite (d2))
+		{
+			maxAbsError = INFINITY;
+			steps += 2;
+			continue;
+		}
+
+		// Within the 24 bit resolution counts as identical
+		const double e1 = std::max (fabs (d1) - 0.5 * q1, 0.0);
+		const double e2 = std::max (fabs (d2) - 0.5 * q2, 0.0);
+		maxAbsError = std::max (maxAbsError, std::max (e1, e2));
+		if (fabs (d1) > limit1) ++steps;
+		if (fabs (d2) > limit2) ++steps;
+	}
+
+	rms = sqrt (signal / (2.0 * GOLDEN_SAMPLES));
+	stepShare = double (steps) / (2.0 * GOLDEN_SAMPLES);
+	if (maxAbsError == 0.0) snr = INFINITY;
+	else if (signal == 0.0) snr = -INFINITY;
+	else snr = 10.0 * log10 (signal / noise);
+}
+
+static void usage (const char* name)
+{
+	fprintf (stderr, "Usage: %s [-w] [-t target] directory\n", name);
+	fprintf (stderr, "  -w            Write golden files instead of comparing\n");
+	fprintf (stderr, "  -t target     Only process this target (0..%i or name)\n", MAXEFFECTS - 1);
+}
+
+int main (int argc, char** argv)
+{
+	bool writeMode = false;
+	int onlyTarget = -1;
+
+	int opt;
+	while ((opt = getopt (argc, argv, "wt:h")) != -1)
+	{
+		switch (opt)
+		{
+			case 'w':	writeMode = true;
+					break;
+			case 't':	onlyTarget = -2;
+					for (int i = 0; i < MAXEFFECTS; ++i)
+					{
+						if ((targetNames[i] == optarg) || (std::to_string (i) == optarg)) onlyTarget = i;
+					}
+					break;
+			default:	usage (argv[0]);
+					return (opt == 'h' ? 0 : 1);
+		}
+	}
+
+	if ((argc - optind != 1) || (onlyTarget == -2))
+	{
+		usage (argv[0]);
+		return 1;
+	}
+
+	const std::string dir = argv[optind];
+	int failed = 0;
+	int passed = 0;
+
+	try
+	{
+		for (int t = 0; t < MAXEFFECTS; ++t)
+		{
+			if ((onlyTarget >= 0) && (t != onlyTarget)) continue;
+
+			for (const Variant& v : getVariants (t))
+			{
+				for (int rt = 0; rt < NR_ROUTINGS; ++rt)
+				{
+					const std::string name = targetNames[t] + "_" + v.name + "_" + routingNames[rt];
+					const std::string filename = dir + "/" + name + ".gold";
+					const Rendering r = render (t, v, Routing (rt));
+
+					if (writeMode)
+					{
+						writeGolden (filename, r);
+						printf ("%s written\n", name.c_str ());
+						continue;
+					}
+
+					Golden golden;
+					if (!readGolden (filename, golden))
+					{
+						printf ("%s MISSING\n", name.c_str ());
+						++failed;
+						continue;
+					}
+
+					const Tolerance& tol = tolerances[t];
+					double maxAbsError;
+					double snr;
+					double rms;
+					double stepShare;
+					compare (golden, r, tol.maxAbsError, maxAbsError, snr, rms, stepShare);
+
+					// SNR is dominated by rounding for low level (< -30 dB RMS) renderings
+					const bool ok =
+					(
+						((maxAbsError <= tol.maxAbsError) || ((stepShare <= tol.maxStepShare) && std::isfinite (maxAbsError))) &&
+						((snr >= tol.minSnr) || (rms < GOLDEN_LOW_LEVEL))
+					);
+					printf
+					(
+						"%s %s max_abs_error %g steps %.2f%% snr_db %.1f rms %g\n",
+						name.c_str (), (ok ? "PASS" : "FAIL"), maxAbsError, 100.0 * stepShare, snr, rms
+					);
+					if (ok) ++passed;
+					else ++failed;
+				}
+			}
+		}
+	}
+
+	catch (const std::exception& e)
+	{
+		fprintf (stderr, "%s: %s\n", argv[0], e.what ());
+		return 1;
+	}
+
+	if (!writeMode) printf ("%i passed, %i failed\n", passed, failed);
+	return (failed ? 1 : 0);
+}
@@ -0,0 +1,193 @@
+/* B.Shapr
+ * Beat / envelope shaper LV2 plugin
+ *
+ * Copyright (C) 2019 by Sven Jähnichen
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+// GUI startup time check. Loads a B.Shapr GUI binary, instantiates the GUI
+// in a new X11 window and runs its idle interface until the first frame is
+// shown. The timing spans reported by the GUI (see src/GuiTrace.hpp) are
+// printed. Intended for headless use with a virtual X server, e.g.:
+//	xvfb-run bshapr-guitime [-b bundle/] [-t max_ms] [-w timeout_s] BShapr.lv2/BShaprGUI.so
+// Returns 1 if the time to the first frame exceeds max_ms (default: 1000,
+// 0 disables the limit) or if no frame is shown within the timeout.
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <map>
+#include <fstream>
+#include <sstream>
+#include <chrono>
+#include <thread>
+#include <getopt.h>
+#include <dlfcn.h>
+#include <unistd.h>
+#include <X11/Xlib.h>
+#include <lv2/lv2plug.in/ns/lv2core/lv2.h>
+#include <lv2/lv2plug.in/ns/ext/urid/urid.h>
+#include <lv2/lv2plug.in/ns/extensions/ui/ui.h>
+#include "../src/definitions.hpp"
+#include "../src/GuiTrace.hpp"
+
+static std::map<std::string, LV2_URID> uris;
+
+static LV2_URID mapUri (LV2_URID_Map_Handle handle, const char* uri)
+{
+	std::map<std::string, LV2_URID>::const_iterator it = uris.find (uri);
+	if (it != uris.end ()) return it->second;
+	const LV2_URID urid = uris.size () + 1;
+	uris[uri] = urid;
+	return urid;
+}
+
+static void writeFunction (LV2UI_Controller controller, uint32_t port, uint32_t size, uint32_t protocol, const void* buffer) {}
+
+// Returns the duration of the span first_frame in the trace file or -1
+static double readFirstFrame (const std::string& filename)
+{
+	std::ifstream file (filename);
+	std::string line;
+	while (std::getline (file, line))
+	{
+		std::istringstream iss (line);
+		std::string name;
+		double start;
+		double duration;
+		if ((iss >> name >> start >> duration) && (name == "first_frame")) return duration;
+	}
+	return -1.0;
+}
+
+static void usage (const char* name)
+{
+	fprintf (stderr, "Usage: %s [-b bundle/] [-t max_ms] [-w timeout_s] gui.so\n", name);
+	fprintf (stderr, "  -b bundle/    Bundle path (default: directory of gui.so)\n");
+	fprintf (stderr, "  -t max_ms     Max. time to the first frame (default: 1000, 0: no limit)\n");
+	fprintf (stderr, "  -w timeout_s  Max. time to wait for the first frame (default: 10)\n");
+}
+
+int main (int argc, char** argv)
+{
+	std::string bundlePath = "";
+	double maxMs = 1000.0;
+	double timeout = 10.0;
+
+	int opt;
+	while ((opt = getopt (argc, argv, "b:t:w:h")) != -1)
+	{
+		switch (opt)
+		{
+			case 'b':	bundlePath = optarg;
+					break;
+			case 't':	maxMs = atof (optarg);
+					break;
+			case 'w':	timeout = atof (optarg);
+					break;
+			default:	usage (argv[0]);
+					return (opt == 'h' ? 0 : 1);
+		}
+	}
+
+	if (argc - optind != 1)
+	{
+		usage (argv[0]);
+		return 1;
+	}
+
+	const std::string guiFile = argv[optind];
+	if (bundlePath.empty ())
+	{
+		const size_t pos = guiFile.find_last_of ('/');
+		bundlePath = (pos != std::string::npos ? guiFile.substr (0, pos + 1) : "./");
+	}
+	if (bundlePath.back () != '/') bundlePath += "/";
+
+	// Let the GUI write its trace into a temporary file
+	char traceFile[] = "/tmp/bshapr-guitime-XXXXXX";
+	const int fd = mkstemp (traceFile);
+	if (fd < 0)
+	{
+		fprintf (stderr, "%s: Can't create a temporary file\n", argv[0]);
+		return 1;
+	}
+	close (fd);
+	setenv (GUITRACE_ENV, traceFile, 1);
+
+	Display* display = XOpenDisplay (nullptr);
+	if (!display)
+	{
+		fprintf (stderr, "%s: Can't open X display (use xvfb-run for headless tests)\n", argv[0]);
+		unlink (traceFile);
+		return 1;
+	}
+	Window parent = XCreateSimpleWindow (display, DefaultRootWindow (display), 0, 0, 1200, 710, 0, 0, 0);
+	XMapWindow (display, parent);
+	XSync (display, False);
+
+	void* lib = dlopen (guiFile.c_str (), RTLD_NOW | RTLD_LOCAL);
+	LV2UI_DescriptorFunction descriptorFunction = (lib ? (LV2UI_DescriptorFunction) dlsym (lib, "lv2ui_descriptor") : nullptr);
+	const LV2UI_Descriptor* descriptor = (descriptorFunction ? descriptorFunction (0) : nullptr);
+	if (!descriptor)
+	{
+		fprintf (stderr, "%s: Can't load %s: %s\n", argv[0], guiFile.c_str (), (lib ? "No LV2 UI" : dlerror ()));
+		XCloseDisplay (display);
+		unlink (traceFile);
+		return 1;
+	}
+
+	LV2_URID_Map uridMap {nullptr, mapUri};
+	const LV2_Feature mapFeature {LV2_URID__map, &uridMap};
+	const LV2_Feature parentFeature {LV2_UI__parent, (void*) parent};
+	const LV2_Feature* features[] = {&mapFeature, &parentFeature, nullptr};
+	const LV2UI_Idle_Interface* idle = (descriptor->extension_data ? (const LV2UI_Idle_Interface*) descriptor->extension_data (LV2_UI__idleInterface) : nullptr);
+
+	const std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now ();
+	LV2UI_Widget widget = nullptr;
+	LV2UI_Handle handle = descriptor->instantiate (descriptor, BSHAPR_URI, bundlePath.c_str (), writeFunction, nullptr, &widget, features);
+	int status = 1;
+
+	if (handle && idle)
+	{
+		// Run the GUI until it reports its first frame
+		double firstFrame = -1.0;
+		while ((firstFrame < 0) && (std::chrono::duration<double> (std::chrono::steady_clock::now () - t0).count () < timeout))
+		{
+			idle->idle (handle);
+			firstFrame = readFirstFrame (traceFile);
+			if (firstFrame < 0) std::this_thread::sleep_for (std::chrono::milliseconds (1));
+		}
+
+		std::ifstream file (traceFile);
+		std::string line;
+		printf ("span start_us duration_us\n");
+		while (std::getline (file, line)) printf ("%s\n", line.c_str ());
+
+		if (firstFrame < 0) fprintf (stderr, "%s: No frame shown within %.1f s\n", argv[0], timeout);
+		else if ((maxMs > 0) && (firstFrame > maxMs * 1000)) fprintf (stderr, "%s: First frame after %.1f ms (limit %.1f ms)\n", argv[0], firstFrame / 1000, maxMs);
+		else status = 0;
+	}
+	else fprintf (stderr, "%s: Can't instantiate the GUI\n", argv[0]);
+
+	if (handle) descriptor->cleanup (handle);
+	dlclose (lib);
+	XDestroyWindow (display, parent);
+	XCloseDisplay (display);
+	unlink (traceFile);
+	return status;
+}
@@ -0,0 +1,411 @@
+/* B.Shapr
+ * Beat / envelope shaper LV2 plugin
+ *
+ * Copyright (C) 2019 by Sven Jähnichen
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+// Stand-in LV2 host. Loads a B.Shapr plugin binary, replays a scripted event
+// timeline and measures the run () time and the notify port output size
+// per cycle as well as the state save / restore time. Usage:
+//	bshapr-host [-p plugin.so] [-r rate] [-b blocksize] [-n cycles] [-c cycles.csv]
+//		    [-t max_us] [-a max_bytes] script
+//
+// Each script line contains the cycle, the frame within the cycle and a
+// command:
+//	<cycle> <frame> ui_on
+//	<cycle> <frame> ui_off
+//	<cycle> <frame> position <bar> <barBeat> <bpm> <beatsPerBar> <beatUnit> <speed>
+//	<cycle> <frame> midi <byte> [<byte> ...]
+//	<cycle> <frame> shape <shapeNr> <type> <x> <y> <h1x> <h1y> <h2x> <h2y> [...]
+//	<cycle> <frame> control <symbol> <value>
+//	<cycle> <frame> set <symbol> <value>
+//	<cycle> <frame> runtime_threshold <fraction of the block time>
+//	<cycle> <frame> save
+//	<cycle> <frame> restore
+// Controller changes and state save / restore are executed before the
+// run () of the respective cycle. set changes a controller at the given frame
+// (patch:Set). Empty lines and lines starting with # are
+// ignored. The run () time histogram and overloads reported by the plugin
+// itself (only while ui_on) are printed at the end. Returns 1 if a limit
+// (-t, -a) is exceeded.
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <chrono>
+#include <exception>
+#include <stdexcept>
+#include <getopt.h>
+#include <dlfcn.h>
+#include "Host.hpp"
+
+#define RUNTIMEHISTOGRAMSIZE 16
+#define RUNTIMEOVERLOADSIZE 4
+
+const std::string overloadNames[RUNTIMEOVERLOADSIZE] = {"total", "pitch_search", "delay_search", "shape_render"};
+
+struct RuntimeTelemetry
+{
+	bool received;
+	float threshold;
+	int32_t histogram[RUNTIMEHISTOGRAMSIZE];
+	int32_t overloads[RUNTIMEOVERLOADSIZE];
+};
+
+struct ScriptEvent
+{
+	uint64_t cycle;
+	uint32_t frame;
+	std::string command;
+	std::vector<std::string> args;
+};
+
+static std::vector<ScriptEvent> readScript (const std::string& filename)
+{
+	std::ifstream file (filename);
+	if (!file) throw std::runtime_error ("Can't open " + filename);
+
+	std::vector<ScriptEvent> events;
+	std::string line;
+	int lineNr = 0;
+	while (std::getline (file, line))
+	{
+		++lineNr;
+		const size_t start = line.find_first_not_of (" \t\r");
+		if ((start == std::string::npos) || (line[start] == '#')) continue;
+
+		std::istringstream iss (line);
+		ScriptEvent ev;
+		if (!(iss >> ev.cycle >> ev.frame >> ev.command))
+		{
+			throw std::runtime_error (filename + ":" + std::to_string (lineNr) + ": Can't parse \"" + line + "\"");
+		}
+
+		std::string arg;
+		while (iss >> arg) ev.args.push_back (arg);
+		events.push_back (ev);
+	}
+
+	// Events must be in time order within the atom sequence
+	std::stable_sort
+	(
+		events.begin (),
+		events.end (),
+		[] (const ScriptEvent& a, const ScriptEvent& b) {return (a.cycle < b.cycle) || ((a.cycle == b.cycle) && (a.frame < b.frame));}
+	);
+	return events;
+}
+
+static float getArg (const ScriptEvent& ev, const size_t nr)
+{
+	if (nr >= ev.args.size ()) throw std::runtime_error ("Missing argument for " + ev.command + " in cycle " + std::to_string (ev.cycle));
+	return strtof (ev.args[nr].c_str (), nullptr);
+}
+
+// Copies the (cumulative) run () time telemetry from the notify output
+static void readRuntimeTelemetry (Host& host, RuntimeTelemetry& telemetry)
+{
+	const LV2_URID runtimeEvent = host.map (BSHAPR_URI "#NOTIFYruntimeEvent");
+	const LV2_URID histogramKey = host.map (BSHAPR_URI "#NOTIFYruntimeHistogram");
+	const LV2_URID overloadsKey = host.map (BSHAPR_URI "#NOTIFYruntimeOverloads");
+	const LV2_URID thresholdKey = host.map (BSHAPR_URI "#NOTIFYruntimeThreshold");
+	const LV2_URID objectType = host.map (LV2_ATOM__Object);
+
+	LV2_ATOM_SEQUENCE_FOREACH (host.getNotifySequence (), ev)
+	{
+		if (ev->body.type != objectType) continue;
+		const LV2_Atom_Object* obj = (const LV2_Atom_Object*) &ev->body;
+		if (obj->body.otype != runtimeEvent) continue;
+
+		const LV2_Atom *oHistogram = NULL, *oOverloads = NULL, *oThreshold = NULL;
+		lv2_atom_object_get (obj, histogramKey, &oHistogram, overloadsKey, &oOverloads, thresholdKey, &oThreshold, NULL);
+		if
+		(
+			(!oHistogram) || (oHistogram->size != sizeof (LV2_Atom_Vector_Body) + sizeof (telemetry.histogram)) ||
+			(!oOverloads) || (oOverloads->size != sizeof (LV2_Atom_Vector_Body) + sizeof (telemetry.overloads)) ||
+			(!oThreshold)
+		)
+		{
+			throw std::runtime_error ("Corrupt runtime telemetry");
+		}
+
+		memcpy (telemetry.histogram, &((const LV2_Atom_Vector*) oHistogram)->body + 1, sizeof (telemetry.histogram));
+		memcpy (telemetry.overloads, &((const LV2_Atom_Vector*) oOverloads)->body + 1, sizeof (telemetry.overloads));
+		telemetry.threshold = ((const LV2_Atom_Float*) oThreshold)->body;
+		telemetry.received = true;
+	}
+}
+
+static double getMicroseconds (const std::chrono::steady_clock::time_point& t0)
+{
+	return std::chrono::duration<double, std::micro> (std::chrono::steady_clock::now () - t0).count ();
+}
+
+static void usage (const char* name)
+{
+	fprintf (stderr, "Usage: %s [-p plugin.so] [-r rate] [-b blocksize] [-n cycles] [-c cycles.csv] [-t max_us] [-a max_bytes] script\n", name);
+	fprintf (stderr, "  -p plugin.so  Plugin binary (default BShapr.lv2/BShapr.so)\n");
+	fprintf (stderr, "  -r rate       Sample rate (default 48000)\n");
+	fprintf (stderr, "  -b blocksize  Frames per cycle (default 256)\n");
+	fprintf (stderr, "  -n cycles     Number of cycles (default: last script cycle + 1)\n");
+	fprintf (stderr, "  -c cycles.csv Write run () time and notify size per cycle\n");
+	fprintf (stderr, "  -t max_us     Fail if a run () call takes longer\n");
+	fprintf (stderr, "  -a max_bytes  Fail if the notify output of a cycle is larger\n");
+}
+
+int main (int argc, char** argv)
+{
+	std::string pluginFile = "BShapr.lv2/BShapr.so";
+	double rate = 48000.0;
+	uint32_t blockSize = 256;
+	uint64_t nrCycles = 0;
+	std::string csvFile = "";
+	double maxUs = 0.0;
+	uint32_t maxBytes = 0;
+
+	int opt;
+	while ((opt = getopt (argc, argv, "p:r:b:n:c:t:a:h")) != -1)
+	{
+		switch (opt)
+		{
+			case 'p':	pluginFile = optarg;
+					break;
+			case 'r':	rate = atof (optarg);
+					break;
+			case 'b':	blockSize = atoi (optarg);
+					break;
+			case 'n':	nrCycles = strtoull (optarg, nullptr, 10);
+					break;
+			case 'c':	csvFile = optarg;
+					break;
+			case 't':	maxUs = atof (optarg);
+					break;
+			case 'a':	maxBytes = atoi (optarg);
+					break;
+			default:	usage (argv[0]);
+					return (opt == 'h' ? 0 : 1);
+		}
+	}
+
+	if ((argc - optind != 1) || (blockSize == 0) || (rate <= 0.0))
+	{
+		usage (argv[0]);
+		return 1;
+	}
+
+	void* lib = dlopen (pluginFile.c_str (), RTLD_NOW | RTLD_LOCAL);
+	if (!lib)
+	{
+		fprintf (stderr, "%s: %s\n", argv[0], dlerror ());
+		return 1;
+	}
+
+	typedef const LV2_Descriptor* (*DescriptorFunction) (uint32_t index);
+	DescriptorFunction getDescriptor = (DescriptorFunction) dlsym (lib, "lv2_descriptor");
+	if (!getDescriptor)
+	{
+		fprintf (stderr, "%s: %s has no lv2_descriptor\n", argv[0], pluginFile.c_str ());
+		dlclose (lib);
+		return 1;
+	}
+
+	int status = 0;
+	try
+	{
+		const std::vector<ScriptEvent> events = readScript (argv[optind]);
+		if ((nrCycles == 0) && (!events.empty ())) nrCycles = events.back ().cycle + 1;
+
+		FILE* csv = nullptr;
+		if (!csvFile.empty ())
+		{
+			csv = fopen (csvFile.c_str (), "w");
+			if (!csv) throw std::runtime_error ("Can't write " + csvFile);
+			fprintf (csv, "cycle,run_us,notify_bytes\n");
+		}
+
+		Host host (getDescriptor (0), rate, blockSize);
+
+		// Deterministic noise at -6 dB
+		std::vector<float> input1 (blockSize);
+		std::vector<float> input2 (blockSize);
+		std::vector<float> output1 (blockSize);
+		std::vector<float> output2 (blockSize);
+		uint32_t seed = 0x1234567;
+		for (uint32_t i = 0; i < blockSize; ++i)
+		{
+			seed = seed * 1664525 + 1013904223;
+			input1[i] = 0.5f * (float (seed >> 8) / 8388608.0f - 1.0f);
+			seed = seed * 1664525 + 1013904223;
+			input2[i] = 0.5f * (float (seed >> 8) / 8388608.0f - 1.0f);
+		}
+
+		std::string savedShapes = "";
+		double runSum = 0.0;
+		double runMax = 0.0;
+		uint64_t notifySum = 0;
+		uint32_t notifyMax = 0;
+		double saveSum = 0.0;
+		double saveMax = 0.0;
+		int saveCount = 0;
+		double restoreSum = 0.0;
+		double restoreMax = 0.0;
+		int restoreCount = 0;
+		uint64_t runViolations = 0;
+		uint64_t notifyViolations = 0;
+		RuntimeTelemetry telemetry {};
+
+		std::vector<ScriptEvent>::const_iterator it = events.begin ();
+		for (uint64_t cycle = 0; cycle < nrCycles; ++cycle)
+		{
+			for (; (it != events.end ()) && (it->cycle == cycle); ++it)
+			{
+				const ScriptEvent& ev = *it;
+				const uint32_t frame = std::min (ev.frame, blockSize - 1);
+
+				if (ev.command == "ui_on") host.addObject (frame, host.map (BSHAPR_URI "#UIon"));
+				else if (ev.command == "ui_off") host.addObject (frame, host.map (BSHAPR_URI "#UIoff"));
+				else if (ev.command == "position")
+				{
+					host.addTimePosition
+					(
+						frame, getArg (ev, 0), getArg (ev, 1), getArg (ev, 2),
+						getArg (ev, 3), getArg (ev, 4), getArg (ev, 5)
+					);
+				}
+
+				else if (ev.command == "midi")
+				{
+					std::vector<uint8_t> msg;
+					for (const std::string& a : ev.args) msg.push_back (strtol (a.c_str (), nullptr, 0));
+					if (msg.empty ()) throw std::runtime_error ("Empty MIDI message in cycle " + std::to_string (cycle));
+					host.addMidi (frame, msg.data (), msg.size ());
+				}
+
+				else if (ev.command == "shape")
+				{
+					if ((ev.args.size () < 1) || ((ev.args.size () - 1) % 7))
+					{
+						throw std::runtime_error ("Shape data must contain 7 values per node in cycle " + std::to_string (cycle));
+					}
+					std::vector<float> data;
+					for (size_t i = 1; i < ev.args.size (); ++i) data.push_back (getArg (ev, i));
+					host.addShape (frame, getArg (ev, 0), data);
+				}
+
+				else if (ev.command == "control")
+				{
+					if (ev.args.size () < 2) throw std::runtime_error ("Missing argument for control in cycle " + std::to_string (cycle));
+					const int nr = host.getControllerNr (ev.args[0]);
+					if (nr < 0) throw std::runtime_error ("Unknown controller " + ev.args[0]);
+					host.setController (nr, getArg (ev, 1));
+				}
+
+				else if (ev.command == "set")
+				{
+					if (ev.args.size () < 2) throw std::runtime_error ("Missing argument for set in cycle " + std::to_string (cycle));
+					const int nr = host.getControllerNr (ev.args[0]);
+					if (nr < 0) throw std::runtime_error ("Unknown controller " + ev.args[0]);
+					host.addParameter (frame, nr, getArg (ev, 1));
+				}
+
+				else if (ev.command == "runtime_threshold") host.addRuntimeThreshold (frame, getArg (ev, 0));
+
+				else if (ev.command == "save")
+				{
+					const std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now ();
+					if (!host.saveShapes (savedShapes)) throw std::runtime_error ("State save failed");
+					const double dt = getMicroseconds (t0);
+					saveSum += dt;
+					saveMax = std::max (saveMax, dt);
+					++saveCount;
+				}
+
+				else if (ev.command == "restore")
+				{
+					const std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now ();
+					if (!host.restoreShapes (savedShapes)) throw std::runtime_error ("State restore failed");
+					const double dt = getMicroseconds (t0);
+					restoreSum += dt;
+					restoreMax = std::max (restoreMax, dt);
+					++restoreCount;
+				}
+
+				else throw std::runtime_error ("Unknown command " + ev.command + " in cycle " + std::to_string (cycle));
+			}
+
+			const std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now ();
+			host.run (input1.data (), input2.data (), output1.data (), output2.data (), blockSize);
+			const double dt = getMicroseconds (t0);
+			const uint32_t notifySize = host.getNotifySize ();
+			readRuntimeTelemetry (host, telemetry);
+
+			runSum += dt;
+			runMax = std::max (runMax, dt);
+			notifySum += notifySize;
+			notifyMax = std::max (notifyMax, notifySize);
+			if ((maxUs > 0.0) && (dt > maxUs)) ++runViolations;
+			if ((maxBytes > 0) && (notifySize > maxBytes)) ++notifyViolations;
+			if (csv) fprintf (csv, "%lu,%.3f,%u\n", (unsigned long) cycle, dt, notifySize);
+		}
+
+		if (csv) fclose (csv);
+
+		printf ("cycles %lu\n", (unsigned long) nrCycles);
+		printf ("run_us mean %.3f max %.3f\n", (nrCycles ? runSum / nrCycles : 0.0), runMax);
+		printf ("notify_bytes mean %.1f max %u\n", (nrCycles ? double (notifySum) / nrCycles : 0.0), notifyMax);
+		printf ("save_us count %i mean %.3f max %.3f\n", saveCount, (saveCount ? saveSum / saveCount : 0.0), saveMax);
+		printf ("restore_us count %i mean %.3f max %.3f\n", restoreCount, (restoreCount ? restoreSum / restoreCount : 0.0), restoreMax);
+
+		if (telemetry.received)
+		{
+			// Bin i: 2^(i-12) .. 2^(i-11) of the block time
+			printf ("runtime_histogram");
+			for (int i = 0; i < RUNTIMEHISTOGRAMSIZE; ++i) printf (" %i", telemetry.histogram[i]);
+			printf ("\n");
+			printf ("runtime_overloads threshold %.3f", telemetry.threshold);
+			for (int i = 0; i < RUNTIMEOVERLOADSIZE; ++i) printf (" %s %i", overloadNames[i].c_str (), telemetry.overloads[i]);
+			printf ("\n");
+		}
+
+		if (runViolations)
+		{
+			fprintf (stderr, "%s: %lu cycles exceeded %.3f us\n", argv[0], (unsigned long) runViolations, maxUs);
+			status = 1;
+		}
+
+		if (notifyViolations)
+		{
+			fprintf (stderr, "%s: %lu cycles exceeded %u notify bytes\n", argv[0], (unsigned long) notifyViolations, maxBytes);
+			status = 1;
+		}
+	}
+
+	catch (const std::exception& e)
+	{
+		fprintf (stderr, "%s: %s\n", argv[0], e.what ());
+		status = 1;
+	}
+
+	dlclose (lib);
+	return status;
+}
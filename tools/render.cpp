@@ -0,0 +1,122 @@
+/* B.Shapr
+ * Beat / envelope shaper LV2 plugin
+ *
+ * Copyright (C) 2019 by Sven Jähnichen
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+// Headless offline renderer. Processes a WAV file with the B.Shapr DSP
+// code as linked into this binary and writes the result as 32 bit float
+// stereo WAV file. Usage:
+//	bshapr-render [-b blocksize] [-p preset] [-t tempomap] input.wav output.wav
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <exception>
+#include <getopt.h>
+#include "Host.hpp"
+#include "Wav.hpp"
+#include "Preset.hpp"
+
+static void usage (const char* name)
+{
+	fprintf (stderr, "Usage: %s [-b blocksize] [-p preset] [-t tempomap] input.wav output.wav\n", name);
+	fprintf (stderr, "  -b blocksize  Frames per run () call (default 512)\n");
+	fprintf (stderr, "  -p preset     Controller values and shapes (\"symbol value\" or \"shp:...\" lines)\n");
+	fprintf (stderr, "  -t tempomap   Tempo changes (\"seconds bpm [beatsPerBar [beatUnit]]\" lines)\n");
+}
+
+static void addPosition (Host& host, const uint32_t frame, const TempoMap& tempoMap, const double time)
+{
+	const TransportPosition p = tempoMap.getPosition (time);
+	host.addTimePosition (frame, p.bar, p.barBeat, p.bpm, p.beatsPerBar, p.beatUnit, 1.0f);
+}
+
+int main (int argc, char** argv)
+{
+	uint32_t blockSize = 512;
+	std::string presetFile = "";
+	std::string tempoFile = "";
+
+	int opt;
+	while ((opt = getopt (argc, argv, "b:p:t:h")) != -1)
+	{
+		switch (opt)
+		{
+			case 'b':	blockSize = atoi (optarg);
+					break;
+			case 'p':	presetFile = optarg;
+					break;
+			case 't':	tempoFile = optarg;
+					break;
+			default:	usage (argv[0]);
+					return (opt == 'h' ? 0 : 1);
+		}
+	}
+
+	if ((argc - optind != 2) || (blockSize == 0))
+	{
+		usage (argv[0]);
+		return 1;
+	}
+
+	try
+	{
+		Wav input;
+		input.read (argv[optind]);
+
+		Preset preset;
+		if (!presetFile.empty ()) preset.read (presetFile);
+
+		TempoMap tempoMap;
+		if (!tempoFile.empty ()) tempoMap.read (tempoFile);
+
+		Host host (lv2_descriptor (0), input.rate, blockSize);
+		preset.apply (host);
+
+		Wav output;
+		output.rate = input.rate;
+		output.resize (input.size ());
+
+		for (size_t start = 0; start < input.size (); start += blockSize)
+		{
+			const uint32_t n = std::min<size_t> (blockSize, input.size () - start);
+			const double time = double (start) / input.rate;
+
+			// Transport position at block start and at each tempo change within the block
+			addPosition (host, 0, tempoMap, time);
+			for (size_t i = tempoMap.getIndex (time) + 1; i < tempoMap.tempos.size (); ++i)
+			{
+				const double changeFrame = tempoMap.tempos[i].time * input.rate;
+				if (changeFrame >= start + n) break;
+				if (changeFrame > start) addPosition (host, uint32_t (changeFrame - start), tempoMap, tempoMap.tempos[i].time);
+			}
+
+			host.run (&input.channel1[start], &input.channel2[start], &output.channel1[start], &output.channel2[start], n);
+		}
+
+		output.write (argv[optind + 1]);
+	}
+
+	catch (const std::exception& e)
+	{
+		fprintf (stderr, "%s: %s\n", argv[0], e.what ());
+		return 1;
+	}
+
+	return 0;
+}
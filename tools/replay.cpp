@@ -0,0 +1,305 @@
+/* B.Shapr
+ * Beat / envelope shaper LV2 plugin
+ *
+ * Copyright (C) 2019 by Sven Jähnichen
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+// Replays a control input capture (written by the plugin if BSHAPR_CAPTURE
+// is set) with the B.Shapr DSP code as linked into this binary. Each
+// captured block is run with the captured block size, controller values and
+// control port events (URIDs translated), and timed. The audio input is
+// deterministic noise or a (looped) WAV file. Usage:
+//	bshapr-replay [-i input.wav] [-o output.wav] [-c blocks.csv] capture.bscap
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <map>
+#include <fstream>
+#include <chrono>
+#include <exception>
+#include <stdexcept>
+#include <getopt.h>
+#include "Host.hpp"
+#include "Wav.hpp"
+#include "Targets.hpp"
+#include "../src/Capture.hpp"
+
+struct CapturedBlock
+{
+	CaptureBlockHeader header;
+	std::vector<CaptureController> controllers;
+	std::vector<uint64_t> sequence;	// 64 bit aligned atom sequence
+};
+
+struct CaptureLog
+{
+	double rate;
+	std::map<uint32_t, std::string> uris;
+	std::vector<CapturedBlock> blocks;
+	uint32_t maxBlockSize;
+};
+
+static void readData (std::ifstream& file, void* data, const size_t size)
+{
+	file.read ((char*) data, size);
+	if (!file) throw std::runtime_error ("Capture file truncated");
+}
+
+static CaptureLog readCapture (const std::string& filename)
+{
+	std::ifstream file (filename, std::ios::binary);
+	if (!file) throw std::runtime_error ("Can't open " + filename);
+
+	CaptureLog log {0.0, {}, {}, 0};
+	char magic[sizeof (CAPTURE_MAGIC)];
+	uint32_t nrControllers;
+	uint32_t nrUris;
+	readData (file, magic, sizeof (magic));
+	if (memcmp (magic, CAPTURE_MAGIC, sizeof (magic))) throw std::runtime_error (filename + " is not a capture file");
+	readData (file, &log.rate, sizeof (log.rate));
+	readData (file, &nrControllers, sizeof (nrControllers));
+	readData (file, &nrUris, sizeof (nrUris));
+	if (nrControllers != NR_CONTROLLERS) throw std::runtime_error (filename + " was captured by another plugin variant (CV / non-CV)");
+
+	for (uint32_t i = 0; i < nrUris; ++i)
+	{
+		uint32_t urid;
+		uint32_t length;
+		readData (file, &urid, sizeof (urid));
+		readData (file, &length, sizeof (length));
+		std::string uri (length, '\0');
+		readData (file, &uri[0], length);
+		log.uris[urid] = uri;
+	}
+
+	CapturedBlock block;
+	while (file.read ((char*) &block.header, sizeof (block.header)))
+	{
+		if (block.header.sequenceSize < sizeof (LV2_Atom_Sequence)) throw std::runtime_error ("Corrupt block in " + filename);
+		block.controllers.resize (block.header.nrControllers);
+		readData (file, block.controllers.data (), block.header.nrControllers * sizeof (CaptureController));
+		block.sequence.assign ((block.header.sequenceSize + sizeof (uint64_t) - 1) / sizeof (uint64_t), 0);
+		readData (file, block.sequence.data (), block.header.sequenceSize);
+		if (block.header.nSamples > log.maxBlockSize) log.maxBlockSize = block.header.nSamples;
+		log.blocks.push_back (block);
+	}
+
+	return log;
+}
+
+// Maps the URIDs of the capturing host to the URIDs of this host
+class UridTranslator
+{
+public:
+	UridTranslator (Host& host, const std::map<uint32_t, std::string>& uris) :
+		urids (),
+		atomObject (host.map (LV2_ATOM__Object)), atomBlank (host.map (LV2_ATOM__Blank)), atomVector (host.map (LV2_ATOM__Vector)),
+		atomUrid (host.map (LV2_ATOM__URID))
+	{
+		for (const std::pair<const uint32_t, std::string>& u : uris) urids[u.first] = host.map (u.second.c_str ());
+	}
+
+	// Unknown URIDs are irrelevant for the DSP and translated to 0
+	LV2_URID translate (const LV2_URID urid) const
+	{
+		std::map<uint32_t, LV2_URID>::const_iterator it = urids.find (urid);
+		return (it != urids.end () ? it->second : 0);
+	}
+
+	void translate (LV2_Atom* atom) const
+	{
+		atom->type = translate (atom->type);
+
+		if ((atom->type == atomObject) || (atom->type == atomBlank))
+		{
+			LV2_Atom_Object* obj = (LV2_Atom_Object*) atom;
+			obj->body.id = translate (obj->body.id);
+			obj->body.otype = translate (obj->body.otype);
+			LV2_ATOM_OBJECT_FOREACH (obj, prop)
+			{
+				prop->key = translate (prop->key);
+				translate (&prop->value);
+			}
+		}
+
+		else if (atom->type == atomVector)
+		{
+			LV2_Atom_Vector* vec = (LV2_Atom_Vector*) atom;
+			vec->body.child_type = translate (vec->body.child_type);
+		}
+
+		else if (atom->type == atomUrid)
+		{
+			LV2_Atom_URID* urid = (LV2_Atom_URID*) atom;
+			urid->body = translate (urid->body);
+		}
+	}
+
+protected:
+	std::map<uint32_t, LV2_URID> urids;
+	LV2_URID atomObject;
+	LV2_URID atomBlank;
+	LV2_URID atomVector;
+	LV2_URID atomUrid;
+};
+
+static void usage (const char* name)
+{
+	fprintf (stderr, "Usage: %s [-i input.wav] [-o output.wav] [-c blocks.csv] capture.bscap\n", name);
+	fprintf (stderr, "  -i input.wav  Audio input, looped (default: noise)\n");
+	fprintf (stderr, "  -o output.wav Write the audio output\n");
+	fprintf (stderr, "  -c blocks.csv Write block size and run () time per block\n");
+}
+
+int main (int argc, char** argv)
+{
+	std::string inputFile = "";
+	std::string outputFile = "";
+	std::string csvFile = "";
+
+	int opt;
+	while ((opt = getopt (argc, argv, "i:o:c:h")) != -1)
+	{
+		switch (opt)
+		{
+			case 'i':	inputFile = optarg;
+					break;
+			case 'o':	outputFile = optarg;
+					break;
+			case 'c':	csvFile = optarg;
+					break;
+			default:	usage (argv[0]);
+					return (opt == 'h' ? 0 : 1);
+		}
+	}
+
+	if (argc - optind != 1)
+	{
+		usage (argv[0]);
+		return 1;
+	}
+
+	try
+	{
+		const CaptureLog log = readCapture (argv[optind]);
+		if (log.blocks.empty ()) throw std::runtime_error ("No blocks captured");
+
+		Wav input;
+		if (!inputFile.empty ())
+		{
+			input.read (inputFile);
+			if (input.rate != uint32_t (log.rate)) fprintf (stderr, "%s: Input sample rate differs from the captured rate\n", argv[0]);
+		}
+		else
+		{
+			input.rate = log.rate;
+			input.resize (log.rate);
+			fillNoise (input.channel1.data (), input.channel2.data (), input.size ());
+		}
+		if (input.size () == 0) throw std::runtime_error ("Empty input");
+
+		FILE* csv = nullptr;
+		if (!csvFile.empty ())
+		{
+			csv = fopen (csvFile.c_str (), "w");
+			if (!csv) throw std::runtime_error ("Can't write " + csvFile);
+			fprintf (csv, "block,frames,run_us\n");
+		}
+
+		Host host (lv2_descriptor (0), log.rate, log.maxBlockSize);
+		const UridTranslator translator (host, log.uris);
+		Wav output;
+		output.rate = log.rate;
+
+		std::vector<float> input1 (log.maxBlockSize);
+		std::vector<float> input2 (log.maxBlockSize);
+		std::vector<float> output1 (log.maxBlockSize);
+		std::vector<float> output2 (log.maxBlockSize);
+		std::vector<uint64_t> atomBuffer;
+		size_t inputPos = 0;
+		uint64_t frames = 0;
+		uint64_t gaps = 0;
+		double runSum = 0.0;
+		double runMax = 0.0;
+		size_t runMaxBlock = 0;
+
+		for (size_t b = 0; b < log.blocks.size (); ++b)
+		{
+			const CapturedBlock& block = log.blocks[b];
+			const uint32_t n = block.header.nSamples;
+			if (block.header.flags & CAPTURE_GAP) ++gaps;
+
+			for (const CaptureController& c : block.controllers)
+			{
+				if (c.index < NR_CONTROLLERS) host.setController (c.index, c.value);
+			}
+
+			const LV2_Atom_Sequence* seq = (const LV2_Atom_Sequence*) block.sequence.data ();
+			LV2_ATOM_SEQUENCE_FOREACH (seq, ev)
+			{
+				const size_t size = sizeof (LV2_Atom) + ev->body.size;
+				atomBuffer.assign ((size + sizeof (uint64_t) - 1) / sizeof (uint64_t), 0);
+				memcpy (atomBuffer.data (), &ev->body, size);
+				translator.translate ((LV2_Atom*) atomBuffer.data ());
+				host.addAtom (ev->time.frames, (const LV2_Atom*) atomBuffer.data ());
+			}
+
+			for (uint32_t i = 0; i < n; ++i, inputPos = (inputPos + 1) % input.size ())
+			{
+				input1[i] = input.channel1[inputPos];
+				input2[i] = input.channel2[inputPos];
+			}
+
+			const std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now ();
+			host.run (input1.data (), input2.data (), output1.data (), output2.data (), n);
+			const double dt = std::chrono::duration<double, std::micro> (std::chrono::steady_clock::now () - t0).count ();
+
+			frames += n;
+			runSum += dt;
+			if (dt > runMax)
+			{
+				runMax = dt;
+				runMaxBlock = b;
+			}
+			if (csv) fprintf (csv, "%lu,%u,%.3f\n", (unsigned long) b, n, dt);
+			if (!outputFile.empty ())
+			{
+				output.channel1.insert (output.channel1.end (), output1.begin (), output1.begin () + n);
+				output.channel2.insert (output.channel2.end (), output2.begin (), output2.begin () + n);
+			}
+		}
+
+		if (csv) fclose (csv);
+		if (!outputFile.empty ()) output.write (outputFile);
+
+		printf ("blocks %lu frames %lu gaps %lu\n", (unsigned long) log.blocks.size (), (unsigned long) frames, (unsigned long) gaps);
+		printf ("run_us mean %.3f max %.3f (block %lu)\n", runSum / log.blocks.size (), runMax, (unsigned long) runMaxBlock);
+		if (gaps) fprintf (stderr, "%s: Capture is incomplete (queue overflow), replay may differ\n", argv[0]);
+	}
+
+	catch (const std::exception& e)
+	{
+		fprintf (stderr, "%s: %s\n", argv[0], e.what ());
+		return 1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,404 @@
+/* B.Shapr
+ * Beat / envelope shaper LV2 plugin
+ *
+ * Copyright (C) 2019 by Sven Jähnichen
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+// Real-time safety check. Interposes the heap (malloc & co, thus also new /
+// delete), pthread mutex / condition and stdio / file I/O functions and
+// runs the DSP through a scenario for each target effect: GUI on / off,
+// valid and corrupt shape data, transport changes, MIDI and controller
+// changes at several block sizes. Any call of an interposed function
+// within run () is reported. Usage:
+//	bshapr-rtcheck [-t target]
+// Returns 1 if a violation is found. Requires glibc.
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <cstdarg>
+#include <string>
+#include <vector>
+#include <exception>
+#include <getopt.h>
+#include <dlfcn.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "Host.hpp"
+#include "Targets.hpp"
+
+#define RTCHECK_MAXVIOLATIONS 64
+
+struct Violation
+{
+	const char* function;
+	uint64_t count;
+};
+
+// Only the thread calling run () is checked (not e.g. the capture writer)
+static thread_local bool inRun = false;
+static Violation violations[RTCHECK_MAXVIOLATIONS];
+static int nrViolations = 0;
+
+// Called from within the interposed functions: No allocation, no I/O
+static void violate (const char* function)
+{
+	if (!inRun) return;
+
+	for (int i = 0; i < nrViolations; ++i)
+	{
+		if (violations[i].function == function)
+		{
+			++violations[i].count;
+			return;
+		}
+	}
+
+	if (nrViolations < RTCHECK_MAXVIOLATIONS) violations[nrViolations++] = Violation {function, 1};
+}
+
+template <typename F> static F next (const char* symbol)
+{
+	return (F) dlsym (RTLD_NEXT, symbol);
+}
+
+extern "C"
+{
+
+// glibc heap
+void* __libc_malloc (size_t size);
+void* __libc_calloc (size_t n, size_t size);
+void* __libc_realloc (void* ptr, size_t size);
+void* __libc_memalign (size_t alignment, size_t size);
+void __libc_free (void* ptr);
+
+void* malloc (size_t size) {violate ("malloc"); return __libc_malloc (size);}
+void* calloc (size_t n, size_t size) {violate ("calloc"); return __libc_calloc (n, size);}
+void* realloc (void* ptr, size_t size) {violate ("realloc"); return __libc_realloc (ptr, size);}
+void free (void* ptr) {if (ptr) violate ("free"); __libc_free (ptr);}
+void* memalign (size_t alignment, size_t size) {violate ("memalign"); return __libc_memalign (alignment, size);}
+void* aligned_alloc (size_t alignment, size_t size) {violate ("aligned_alloc"); return __libc_memalign (alignment, size);}
+
+int posix_memalign (void** ptr, size_t alignment, size_t size)
+{
+	violate ("posix_memalign");
+	*ptr = __libc_memalign (alignment, size);
+	return (*ptr ? 0 : ENOMEM);
+}
+
+// Locks
+int pthread_mutex_lock (pthread_mutex_t* m)
+{
+	violate ("pthread_mutex_lock");
+	static int (*f) (pthread_mutex_t*) = next<int (*) (pthread_mutex_t*)> ("pthread_mutex_lock");
+	return f (m);
+}
+
+int pthread_mutex_trylock (pthread_mutex_t* m)
+{
+	violate ("pthread_mutex_trylock");
+	static int (*f) (pthread_mutex_t*) = next<int (*) (pthread_mutex_t*)> ("pthread_mutex_trylock");
+	return f (m);
+}
+
+int pthread_mutex_unlock (pthread_mutex_t* m)
+{
+	violate ("pthread_mutex_unlock");
+	static int (*f) (pthread_mutex_t*) = next<int (*) (pthread_mutex_t*)> ("pthread_mutex_unlock");
+	return f (m);
+}
+
+int pthread_cond_wait (pthread_cond_t* c, pthread_mutex_t* m)
+{
+	violate ("pthread_cond_wait");
+	static int (*f) (pthread_cond_t*, pthread_mutex_t*) = next<int (*) (pthread_cond_t*, pthread_mutex_t*)> ("pthread_cond_wait");
+	return f (c, m);
+}
+
+int pthread_cond_signal (pthread_cond_t* c)
+{
+	violate ("pthread_cond_signal");
+	static int (*f) (pthread_cond_t*) = next<int (*) (pthread_cond_t*)> ("pthread_cond_signal");
+	return f (c);
+}
+
+// File I/O
+FILE* fopen (const char* path, const char* mode)
+{
+	violate ("fopen");
+	static FILE* (*f) (const char*, const char*) = next<FILE* (*) (const char*, const char*)> ("fopen");
+	return f (path, mode);
+}
+
+int open (const char* path, int flags, ...)
+{
+	violate ("open");
+	va_list args;
+	va_start (args, flags);
+	const mode_t mode = ((flags & O_CREAT) ? va_arg (args, int) : 0);
+	va_end (args);
+	static int (*f) (const char*, int, ...) = next<int (*) (const char*, int, ...)> ("open");
+	return f (path, flags, mode);
+}
+
+ssize_t read (int fd, void* buf, size_t count)
+{
+	violate ("read");
+	static ssize_t (*f) (int, void*, size_t) = next<ssize_t (*) (int, void*, size_t)> ("read");
+	return f (fd, buf, count);
+}
+
+ssize_t write (int fd, const void* buf, size_t count)
+{
+	violate ("write");
+	static ssize_t (*f) (int, const void*, size_t) = next<ssize_t (*) (int, const void*, size_t)> ("write");
+	return f (fd, buf, count);
+}
+
+size_t fwrite (const void* ptr, size_t size, size_t n, FILE* stream)
+{
+	violate ("fwrite");
+	static size_t (*f) (const void*, size_t, size_t, FILE*) = next<size_t (*) (const void*, size_t, size_t, FILE*)> ("fwrite");
+	return f (ptr, size, n, stream);
+}
+
+int fputs (const char* s, FILE* stream)
+{
+	violate ("fputs");
+	static int (*f) (const char*, FILE*) = next<int (*) (const char*, FILE*)> ("fputs");
+	return f (s, stream);
+}
+
+int fputc (int c, FILE* stream)
+{
+	violate ("fputc");
+	static int (*f) (int, FILE*) = next<int (*) (int, FILE*)> ("fputc");
+	return f (c, stream);
+}
+
+int puts (const char* s)
+{
+	violate ("puts");
+	static int (*f) (const char*) = next<int (*) (const char*)> ("puts");
+	return f (s);
+}
+
+int vfprintf (FILE* stream, const char* format, va_list args)
+{
+	violate ("vfprintf");
+	static int (*f) (FILE*, const char*, va_list) = next<int (*) (FILE*, const char*, va_list)> ("vfprintf");
+	return f (stream, format, args);
+}
+
+int fprintf (FILE* stream, const char* format, ...)
+{
+	violate ("fprintf");
+	va_list args;
+	va_start (args, format);
+	static int (*f) (FILE*, const char*, va_list) = next<int (*) (FILE*, const char*, va_list)> ("vfprintf");
+	const int r = f (stream, format, args);
+	va_end (args);
+	return r;
+}
+
+int __fprintf_chk (FILE* stream, int flag, const char* format, ...)
+{
+	violate ("fprintf");
+	va_list args;
+	va_start (args, format);
+	static int (*f) (FILE*, int, const char*, va_list) = next<int (*) (FILE*, int, const char*, va_list)> ("__vfprintf_chk");
+	const int r = f (stream, flag, format, args);
+	va_end (args);
+	return r;
+}
+
+int printf (const char* format, ...)
+{
+	violate ("printf");
+	va_list args;
+	va_start (args, format);
+	static int (*f) (FILE*, const char*, va_list) = next<int (*) (FILE*, const char*, va_list)> ("vfprintf");
+	const int r = f (stdout, format, args);
+	va_end (args);
+	return r;
+}
+
+int __printf_chk (int flag, const char* format, ...)
+{
+	violate ("printf");
+	va_list args;
+	va_start (args, format);
+	static int (*f) (FILE*, int, const char*, va_list) = next<int (*) (FILE*, int, const char*, va_list)> ("__vfprintf_chk");
+	const int r = f (stdout, flag, format, args);
+	va_end (args);
+	return r;
+}
+
+}
+
+// Corrupt node order, validation resets the shape
+const std::vector<float> corruptShape =
+{
+	0, 0.0, 0.0, 0, 0, 0, 0,
+	1, 0.8, 0.5, 0, 0, 0, 0,
+	1, 0.5, 0.2, 0, 0, 0, 0,
+	1, 0.2, 0.7, 0, 0, 0, 0,
+	0, 1.0, 0.0, 0, 0, 0, 0
+};
+
+const std::vector<float> smoothShape =
+{
+	0, 0.0, 0.0, 0, 0, 0, 0,
+	2, 0.3, 0.9, 0, 0, 0, 0,
+	4, 0.6, 0.2, -0.1, 0.1, 0.1, -0.1,
+	0, 1.0, 0.0, 0, 0, 0, 0
+};
+
+const uint32_t checkBlockSizes[] = {1, 17, 256, 4096};
+
+// Runs one cycle with violation tracking enabled
+static void runChecked (Host& host, std::vector<float>* buffers, const uint32_t n)
+{
+	inRun = true;
+	host.run (buffers[0].data (), buffers[1].data (), buffers[2].data (), buffers[3].data (), n);
+	inRun = false;
+}
+
+static void check (const int target, const Variant& variant, const uint32_t blockSize)
+{
+	Host host (lv2_descriptor (0), 48000.0, blockSize);
+	host.setController (SHAPERS + SH_TARGET, target);
+	if (variant.option != NO_OPT) host.setController (SHAPERS + SH_OPTION + variant.option, variant.value);
+
+	std::vector<float> buffers[4];
+	for (std::vector<float>& b : buffers) b.resize (blockSize, 0.0f);
+	fillNoise (buffers[0].data (), buffers[1].data (), blockSize);
+
+	const uint8_t noteOn[3] = {0x90, 60, 100};
+	const uint8_t noteOff[3] = {0x80, 60, 0};
+	const uint32_t mid = blockSize / 2;
+
+	// Warm up (first run may initialize lazily)
+	runChecked (host, buffers, blockSize);
+
+	for (int base = SECONDS; base <= BARS; ++base)
+	{
+		host.setController (BASE, base);
+		host.addObject (0, host.map (BSHAPR_URI "#UIon"));
+		host.addTimePosition (0, 0, 0.0f, 120.0f, 4.0f, 4, 1.0f);
+		runChecked (host, buffers, blockSize);
+
+		host.addShape (mid, 0, smoothShape);
+		host.addTimePosition (mid, 3, 1.5f, 90.0f, 3.0f, 4, 1.0f);
+		runChecked (host, buffers, blockSize);
+
+		host.addShape (0, 0, corruptShape);
+		host.addTimePosition (mid, 3, 2.0f, 90.0f, 3.0f, 4, 0.0f);
+		runChecked (host, buffers, blockSize);
+
+		host.setController (MIDI_CONTROL, 1.0f);
+		host.setController (MIDI_THRU, 1.0f);
+		host.addTimePosition (0, 3, 2.0f, 140.0f, 4.0f, 4, 1.0f);
+		host.addMidi (mid, noteOn, 3);
+		runChecked (host, buffers, blockSize);
+
+		host.addMidi (mid, noteOff, 3);
+		host.setController (SHAPERS + SH_INPUT, CONSTANT);
+		host.setController (SHAPERS + SH_SMOOTHING, 0.0f);
+		runChecked (host, buffers, blockSize);
+
+		host.setController (MIDI_CONTROL, 0.0f);
+		host.setController (MIDI_THRU, 0.0f);
+		host.setController (SHAPERS + SH_INPUT, AUDIO_IN);
+		host.setController (SHAPERS + SH_SMOOTHING, 20.0f);
+		host.setController (BYPASS, 1.0f);
+		runChecked (host, buffers, blockSize);
+
+		host.setController (BYPASS, 0.0f);
+		host.addObject (mid, host.map (BSHAPR_URI "#UIoff"));
+		runChecked (host, buffers, blockSize);
+	}
+}
+
+static void usage (const char* name)
+{
+	fprintf (stderr, "Usage: %s [-t target]\n", name);
+	fprintf (stderr, "  -t target     Only check this target (0..%i or name)\n", MAXEFFECTS - 1);
+}
+
+int main (int argc, char** argv)
+{
+	int onlyTarget = -1;
+
+	int opt;
+	while ((opt = getopt (argc, argv, "t:h")) != -1)
+	{
+		switch (opt)
+		{
+			case 't':	onlyTarget = -2;
+					for (int i = 0; i < MAXEFFECTS; ++i)
+					{
+						if ((targetNames[i] == optarg) || (std::to_string (i) == optarg)) onlyTarget = i;
+					}
+					break;
+			default:	usage (argv[0]);
+					return (opt == 'h' ? 0 : 1);
+		}
+	}
+
+	if ((optind != argc) || (onlyTarget == -2))
+	{
+		usage (argv[0]);
+		return 1;
+	}
+
+	int failed = 0;
+	try
+	{
+		for (int t = 0; t < MAXEFFECTS; ++t)
+		{
+			if ((onlyTarget >= 0) && (t != onlyTarget)) continue;
+
+			for (const Variant& v : getVariants (t))
+			{
+				for (uint32_t b : checkBlockSizes)
+				{
+					nrViolations = 0;
+					check (t, v, b);
+
+					if (nrViolations == 0) continue;
+
+					++failed;
+					printf ("%s_%s blocksize %u FAIL:", targetNames[t].c_str (), v.name.c_str (), b);
+					for (int i = 0; i < nrViolations; ++i) printf (" %s (%lu)", violations[i].function, (unsigned long) violations[i].count);
+					printf ("\n");
+				}
+			}
+		}
+	}
+
+	catch (const std::exception& e)
+	{
+		inRun = false;
+		fprintf (stderr, "%s: %s\n", argv[0], e.what ());
+		return 1;
+	}
+
+	printf ("%s\n", (failed ? "Real-time violations found" : "No real-time violations found"));
+	return (failed ? 1 : 0);
+}